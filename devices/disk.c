@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -45,8 +47,8 @@
    Many more are defined but this is the small subset that we
    use. */
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
-#define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
-#define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR(S) with retries. */
+#define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR(S) with retries. */
 
 /* An ATA device. */
 struct disk {
@@ -71,7 +73,8 @@ struct channel {
 	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
-	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+	struct semaphore completion_wait;   /* Up'd by `completion'. */
+	struct work completion;     /* Deferred by interrupt handler. */
 
 	struct disk devices[2];     /* The devices on this channel. */
 };
@@ -84,7 +87,8 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sectors (struct disk *, disk_sector_t, size_t cnt);
+static int disk_number (const struct disk *);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -95,6 +99,7 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static work_func complete;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -122,6 +127,7 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		work_init (&c->completion, complete, c);
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -209,47 +215,97 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
+	disk_read_multiple (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   DISK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+	disk_write_multiple (d, sec_no, 1, buffer);
+}
+
+/* Reads CNT consecutive sectors, starting at SEC_NO, from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  Issues a single command for all of them, so the disk
+   takes one command setup and one seek instead of CNT.  CNT must
+   be between 1 and DISK_MULTIPLE_MAX.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffer_) {
+	uint8_t *buffer = buffer_;
 	struct channel *c;
+	size_t i;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
 
 	c = d->channel;
+	trace_record (TRACE_DISK_READ, disk_number (d), sec_no);
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sectors (d, sec_no, cnt);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
+	/* The disk interrupts once per sector it has ready. */
+	for (i = 0; i < cnt; i++) {
+		sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name,
+					(disk_sector_t) (sec_no + i));
+		input_sector (c, buffer + i * DISK_SECTOR_SIZE);
+	}
+	d->read_cnt += cnt;
 	lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   DISK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT consecutive sectors, starting at SEC_NO, to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes,
+   in a single command.  Returns after the disk has acknowledged
+   receiving the data.  CNT must be between 1 and
+   DISK_MULTIPLE_MAX.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 void
-disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
+disk_write_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		const void *buffer_) {
+	const uint8_t *buffer = buffer_;
 	struct channel *c;
+	size_t i;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
 
 	c = d->channel;
+	trace_record (TRACE_DISK_WRITE, disk_number (d), sec_no);
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sectors (d, sec_no, cnt);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
+	/* The disk asks for each sector in turn, and interrupts once
+	   it has taken it. */
+	for (i = 0; i < cnt; i++) {
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name,
+					(disk_sector_t) (sec_no + i));
+		output_sector (c, buffer + i * DISK_SECTOR_SIZE);
+		sema_down (&c->completion_wait);
+	}
+	d->write_cnt += cnt;
 	lock_release (&c->lock);
 }
 
+/* Returns D's number for trace events: 2 * channel + device, so
+   that hd1:0 is 2. */
+static int
+disk_number (const struct disk *d) {
+	return (d->channel - channels) * 2 + d->dev_no;
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -402,17 +458,19 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
+   writes SEC_NO to the disk's sector selection registers and CNT
+   to its sector count register, where 0 stands for 256.  (We
    use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sectors (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt & 0xff);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -520,7 +578,7 @@ interrupt_handler (struct intr_frame *f) {
 		if (f->vec_no == c->irq) {
 			if (c->expecting_interrupt) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
-				sema_up (&c->completion_wait);      /* Wake up waiter. */
+				intr_defer (&c->completion);        /* Wake up waiter. */
 			} else
 				printf ("%s: unexpected interrupt\n", c->name);
 			return;
@@ -529,6 +587,14 @@ interrupt_handler (struct intr_frame *f) {
 	NOT_REACHED ();
 }
 
+/* Wakes up the thread waiting for channel C_ to complete a
+   command.  Deferred by interrupt_handler(). */
+static void
+complete (void *c_) {
+	struct channel *c = c_;
+	sema_up (&c->completion_wait);
+}
+
 static void
 inspect_read_cnt (struct intr_frame *f) {
 	struct disk * d = disk_get (f->R.rdx, f->R.rcx);
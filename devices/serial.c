@@ -7,6 +7,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* Register definitions for the 16550A UART used in PCs.
    The 16550A has a lot more going on than shown here, but this
@@ -54,10 +55,15 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Moves bytes to and from the UART, deferred by the interrupt
+   handler. */
+static struct work service_work;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
+static work_func serial_service;
 
 /* Initializes the serial port device for polling mode.
    Polling mode busy-waits for the serial port to become free
@@ -85,6 +91,7 @@ serial_init_queue (void) {
 		init_poll ();
 	ASSERT (mode == POLL);
 
+	work_init (&service_work, serial_service, NULL);
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
@@ -106,8 +113,9 @@ serial_putc (uint8_t byte) {
 	} else {
 		/* Otherwise, queue a byte and update the interrupt enable
 		   register. */
-		if (old_level == INTR_OFF && intq_full (&txq)) {
-			/* Interrupts are off and the transmit queue is full.
+		if ((old_level == INTR_OFF || intr_context ()) && intq_full (&txq)) {
+			/* Interrupts are off, or we are in interrupt context
+			   and may not sleep, and the transmit queue is full.
 			   If we wanted to wait for the queue to empty,
 			   we'd have to reenable interrupts.
 			   That's impolite, so we'll send a character via
@@ -193,23 +201,48 @@ putc_poll (uint8_t byte) {
 	outb (THR_REG, byte);
 }
 
-/* Serial interrupt handler. */
+/* Serial interrupt handler.  Leaves moving the bytes to
+   serial_service(). */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) {
 	/* Inquire about interrupt in UART.  Without this, we can
 	   occasionally miss an interrupt running under QEMU. */
 	inb (IIR_REG);
 
-	/* As long as we have room to receive a byte, and the hardware
-	   has a byte for us, receive a byte.  */
-	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
-		input_putc (inb (RBR_REG));
+	/* Quiet the UART until serial_service() has run. */
+	outb (IER_REG, 0);
+	intr_defer (&service_work);
+}
 
-	/* As long as we have a byte to transmit, and the hardware is
-	   ready to accept a byte for transmission, transmit a byte. */
-	while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-		outb (THR_REG, intq_getc (&txq));
+/* Receives and transmits bytes until neither is possible, turning
+   interrupts off for one byte each way at a time.  Deferred by
+   serial_interrupt(). */
+static void
+serial_service (void *aux UNUSED) {
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		bool moved = false;
+
+		/* If we have room to receive a byte, and the hardware has
+		   a byte for us, receive a byte. */
+		if (!input_full () && (inb (LSR_REG) & LSR_DR) != 0) {
+			input_putc (inb (RBR_REG));
+			moved = true;
+		}
 
-	/* Update interrupt enable register based on queue status. */
-	write_ier ();
+		/* If we have a byte to transmit, and the hardware is ready
+		   to accept a byte for transmission, transmit a byte. */
+		if (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) {
+			outb (THR_REG, intq_getc (&txq));
+			moved = true;
+		}
+
+		/* Update interrupt enable register based on queue status. */
+		if (!moved)
+			write_ier ();
+		intr_set_level (old_level);
+
+		if (!moved)
+			break;
+	}
 }
@@ -1,12 +1,16 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -19,7 +23,44 @@
 
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
-struct semaphore sema;
+
+/* If false (default), the PIT interrupts TIMER_FREQ times per
+   second at all times.
+   If true, the idle thread switches the PIT to a one-shot
+   countdown that expires at the next wake-up deadline.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* 8254 input clock, in Hz, and the counter value that makes
+   counter 0 fire once per timer tick. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Number of whole ticks covered by the one-shot countdown armed
+   by timer_idle_enter(), or 0 while the PIT is periodic. */
+static int64_t oneshot_ticks;
+
+/* True while a one-shot countdown armed by timer_idle_exit() runs
+   out the tick that an interrupt cut short, after which
+   timer_interrupt() makes the PIT periodic again. */
+static bool pit_resync;
+
+/* Threads blocked in timer_sleep(), ordered by wake-up tick
+   (`tick_s').  next_wakeup caches the earliest wake-up tick in
+   the heap, or INT64_MAX if it is empty, so that a tick with
+   nothing due costs a single comparison. */
+static struct heap sleep_heap;
+static int64_t next_wakeup;
+
+/* Wakes sleepers once their tick arrives, deferred by the timer
+   interrupt so that it does not keep interrupts off while
+   unblocking them. */
+static struct work wakeup_work;
+
+/* Number of timer interrupts handled and TSC cycles spent in the
+   handler, for benchmarking. */
+static int64_t timer_intr_cnt;
+static uint64_t timer_intr_cycles;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -30,28 +71,121 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 
-/*function for alarm - sleep*/
-static void sema_sleep (struct semaphore *sema);
-static void sema_awake (struct semaphore *sema, int64_t ticks);
+static work_func timer_wakeup;
+static heap_less_func wakeup_less;
+static void pit_periodic (void);
+static void pit_oneshot (uint16_t count);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
+  pit_periodic ();
+
+  heap_init (&sleep_heap, wakeup_less, NULL);
+  next_wakeup = INT64_MAX;
+  work_init (&wakeup_work, timer_wakeup, NULL);
+
+  intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+}
+
+/* Programs counter 0 to interrupt every PIT_TICK_COUNT input
+   clocks, that is, TIMER_FREQ times per second. */
+static void
+pit_periodic (void) {
   /* 8254 input frequency divided by TIMER_FREQ, rounded to
      nearest. */
-  uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+  uint16_t count = PIT_TICK_COUNT;
 
   outb (0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
   outb (0x40, count & 0xff);
   outb (0x40, count >> 8);
+}
 
-  sema = *(struct semaphore *) malloc (sizeof (struct semaphore));
-  sema.waiters = *(struct list *) malloc (sizeof (struct list));
-  sema_init (&sema, 0);
+/* Programs counter 0 to interrupt once, COUNT input clocks from
+   now. */
+static void
+pit_oneshot (uint16_t count) {
+  outb (0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+  outb (0x40, count & 0xff);
+  outb (0x40, count >> 8);
+}
 
-  intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick by
+   a single one-shot countdown that expires at the earliest
+   sleeper's wake-up tick (or the next second boundary, if that
+   comes first, for the 4.4BSD scheduler).  The running thread is
+   the idle thread, whose time slice does not matter: any thread
+   that becomes ready wakes the CPU and preempts it.  The 8254 counter is only 16 bits
+   wide, so one countdown spans at most 65535 / PIT_TICK_COUNT
+   ticks (5 at 100 Hz); a longer idle period simply takes one
+   interrupt per countdown. */
+void
+timer_idle_enter (void) {
+  int64_t idle_ticks;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (!timer_tickless || oneshot_ticks != 0 || pit_resync)
+    return;
+
+  idle_ticks = next_wakeup - ticks;
+  if (thread_mlfqs && idle_ticks > TIMER_FREQ - ticks % TIMER_FREQ)
+    /* Keep the once-per-second load_avg update on time. */
+    idle_ticks = TIMER_FREQ - ticks % TIMER_FREQ;
+  if (idle_ticks > 0xffff / PIT_TICK_COUNT)
+    idle_ticks = 0xffff / PIT_TICK_COUNT;
+  if (idle_ticks < 2)
+    return;
+
+  oneshot_ticks = idle_ticks;
+  pit_oneshot (idle_ticks * PIT_TICK_COUNT);
+}
+
+/* Called at the start of every external interrupt.  If the CPU
+   was idling on a one-shot countdown, advances `ticks' by the
+   whole ticks that elapsed, so that timer_ticks() and
+   timer_elapsed() stay accurate no matter which device woke the
+   CPU.  If the countdown had not expired, it then counts down
+   what is left of the tick in progress before the PIT goes back
+   to periodic, so that the part of the tick already spent idle
+   is not lost. */
+void
+timer_idle_exit (void) {
+  uint8_t status;
+  uint16_t remaining;
+  int64_t elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (oneshot_ticks == 0)
+    return;
+
+  /* Read-back command: latch status and count of counter 0. */
+  outb (0x43, 0xc2);
+  status = inb (0x40);
+  remaining = inb (0x40);
+  remaining |= inb (0x40) << 8;
+
+  if (status & 0x80) {
+    /* OUT is high: the countdown expired.  The last tick is
+       accounted by timer_interrupt(), which is running now or
+       is pending at the PIC. */
+    elapsed = oneshot_ticks - 1;
+    pit_periodic ();
+  } else {
+    int64_t spent = oneshot_ticks * PIT_TICK_COUNT - remaining;
+
+    /* timer_interrupt() accounts the tick in progress once the
+       rest of it runs out. */
+    elapsed = spent / PIT_TICK_COUNT;
+    pit_resync = true;
+    pit_oneshot (PIT_TICK_COUNT - spent % PIT_TICK_COUNT);
+  }
+
+  ticks += elapsed;
+  thread_add_idle_ticks (elapsed);
+  oneshot_ticks = 0;
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -99,49 +233,72 @@ timer_elapsed (int64_t then) {
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
-  int64_t start = timer_ticks ();   //현재 ticks을 받아와 start에 저장
+  int64_t start = timer_ticks ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
+  if (ticks <= 0)
+    return;
 
-  thread_current ()->tick_s = start + ticks;
-  // 현재 thread의 tick_s에 OS시작부터 자야할 시간까지를
-  // 포함한 ticks를 저장
-  while (timer_elapsed (start) < ticks) {
-    // TODO: sema_down과 큰 차이가 없으므로, 추후에도 문제가 없다면 대체할 것
-    sema_sleep (&sema);   // 현재 thread를 semaphore에 넣고 재운다
-  }
+  old_level = intr_disable ();
+  timer_block_until (start + ticks);
+  intr_set_level (old_level);
+}
+
+/* Blocks the running thread until timer tick WAKEUP.  Interrupts
+   must be off. */
+void
+timer_block_until (int64_t wakeup) {
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* 깨어나야 할 절대 tick을 key로 sleep heap에 넣고 block.
+     timer_interrupt가 정확히 그 tick에 unblock 해주므로
+     다시 확인하며 도는 loop는 필요 없음 */
+  cur->tick_s = wakeup;
+  heap_push (&sleep_heap, &cur->sleep_elem);
+  if (cur->tick_s < next_wakeup)
+    next_wakeup = cur->tick_s;
+  thread_block ();
 }
 
+/* Wakes every sleeping thread whose wake-up tick has arrived and
+   refreshes next_wakeup.  Deferred by the timer interrupt, so it
+   runs with interrupts on and turns them off only to wake one
+   thread at a time. */
 static void
-sema_sleep (struct semaphore *sema) {
-  enum intr_level old_level;     // interrupt를 막기위한 변수
-  old_level = intr_disable ();   // interrupt 막기 시작
-  while (sema->value == 0) {
-    // value가 0이라면 이미 다른 누군가가 접근해있는 상태이니
-    list_push_back (&sema->waiters, &thread_current ()->elem);
-    // 대기 리스트에 넣고
-    thread_block ();   // 현재 thread의 상태를 block으로 전환
+timer_wakeup (void *aux UNUSED) {
+  for (;;) {
+    enum intr_level old_level = intr_disable ();
+    struct thread *t;
+
+    if (heap_empty (&sleep_heap)) {
+      next_wakeup = INT64_MAX;
+      intr_set_level (old_level);
+      break;
+    }
+    t = heap_entry (heap_top (&sleep_heap), struct thread, sleep_elem);
+    if (t->tick_s > ticks) {
+      next_wakeup = t->tick_s;
+      intr_set_level (old_level);
+      break;
+    }
+    heap_pop (&sleep_heap);
+    thread_unblock (t);
+    intr_set_level (old_level);
   }
-  sema->value--;   // while문에 걸렸거나 혹은 탈출했다면 해당 프로세스에
-                   // 진입한거니 진입 checke
-  intr_set_level (old_level);   // interrupt를 이전 상태로 돌림
+  test_max_priority ();
 }
 
-void
-sema_awake(struct semaphore *sema, int64_t ticks){ // sema가 깨는 타이밍을 잡는 함수
-	struct thread *temp; // 임시 thread를 선언
-	// enum intr_level old_level;
-	size_t waiter_size = list_size(&sema->waiters);
-	
-		for (int i=0 ; i<waiter_size ; i++)	{ // sema->watier 가 비어있지 않다면 즉, 대기하는 애들이 있다면
-			temp = list_entry (list_pop_front (&sema->waiters), struct thread, elem); // 제일 앞에 있는 애를 pop하고 임시 thread로 확장
-			if (temp->tick_s <= ticks){ // 임시 thread의 tick_s이 time_interrupt의 ticks(OS ticks)보다 작다면 이제 깨어나야하니깐
-				thread_unblock(temp); // 깨워주고
-				sema->value++; // 프로세스에서 탈출하니깐 value++ 해줌
-			}
-			else
-				list_push_back(&sema->waiters, &temp->elem);	// ticks의 시간이 안되었다면 다시 list 제일 뒤에 넣어줌
-		}
+/* Orders sleeping threads by wake-up tick. */
+static bool
+wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED) {
+  const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+
+  return a->tick_s < b->tick_s;
 }
 
 /* Suspends execution for approximately MS milliseconds. */
@@ -168,15 +325,36 @@ timer_print_stats (void) {
   printf ("Timer: %" PRId64 " ticks\n", timer_ticks ());
 }
 
+/* Stores the number of timer interrupts handled so far in *CNT
+   and the total TSC cycles spent handling them in *CYCLES. */
+void
+timer_intr_stats (int64_t *cnt, uint64_t *cycles) {
+  enum intr_level old_level = intr_disable ();
+  *cnt = timer_intr_cnt;
+  *cycles = timer_intr_cycles;
+  intr_set_level (old_level);
+}
+
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_interrupt (struct intr_frame *args) {
+  uint64_t start = rdtsc ();
+
+  if (pit_resync) {
+    pit_periodic ();
+    pit_resync = false;
+  }
+
   ticks++;
-  thread_tick ();
+  profile_sample (args);
+  thread_tick (args);
+
+  // 가장 먼저 깨어날 thread의 tick이 되었을 때만 sleep heap을 확인
+  if (ticks >= next_wakeup)
+    intr_defer (&wakeup_work);
 
-  // timer_interrupt는 tick이 절대적으로 흐르니깐 해당
-  // tick을 이용하여 sema를 깨운다
-  sema_awake (&sema, ticks);
+  timer_intr_cnt++;
+  timer_intr_cycles += rdtsc () - start;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
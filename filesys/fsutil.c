@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,10 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Next sector on the scratch disk for fsutil_get() and
+ * fsutil_get_buffer() to write. */
+static disk_sector_t get_sector;
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) {
@@ -139,8 +144,6 @@ fsutil_put (char **argv) {
  * fsutil_put(), so all `put's should precede all `get's. */
 void
 fsutil_get (char **argv) {
-	static disk_sector_t sector = 0;
-
 	const char *file_name = argv[1];
 	void *buffer;
 	struct file *src;
@@ -165,21 +168,21 @@ fsutil_get (char **argv) {
 	if (dst == NULL)
 		PANIC ("couldn't open target disk (hdc or hd1:0)");
 
-	/* Write size to sector 0. */
+	/* Write size to the current sector. */
 	memset (buffer, 0, DISK_SECTOR_SIZE);
 	memcpy (buffer, "GET", 4);
 	((int32_t *) buffer)[1] = size;
-	disk_write (dst, sector++, buffer);
+	disk_write (dst, get_sector++, buffer);
 
 	/* Do copy. */
 	while (size > 0) {
 		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		if (sector >= disk_size (dst))
+		if (get_sector >= disk_size (dst))
 			PANIC ("%s: out of space on scratch disk", file_name);
 		if (file_read (src, buffer, chunk_size) != chunk_size)
 			PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
 		memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
-		disk_write (dst, sector++, buffer);
+		disk_write (dst, get_sector++, buffer);
 		size -= chunk_size;
 	}
 
@@ -187,3 +190,49 @@ fsutil_get (char **argv) {
 	file_close (src);
 	free (buffer);
 }
+
+/* Copies the SIZE bytes at DATA to the scratch disk, in the same
+ * format and at the same position as fsutil_get() would copy a
+ * file, so that the host picks them up like a gotten file.  NAME
+ * is used only in messages.  Returns true if successful, false
+ * if there is no scratch disk or not enough room on it. */
+bool
+fsutil_get_buffer (const char *name, const void *data, size_t size) {
+	struct disk *dst;
+	uint8_t *buffer;
+	const uint8_t *src = data;
+	disk_sector_t sector_cnt = DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+
+	dst = disk_get (1, 0);
+	if (dst == NULL) {
+		printf ("%s: no scratch disk (hdc or hd1:0)\n", name);
+		return false;
+	}
+	if (get_sector + 1 + sector_cnt > disk_size (dst)) {
+		printf ("%s: out of space on scratch disk\n", name);
+		return false;
+	}
+
+	buffer = malloc (DISK_SECTOR_SIZE);
+	if (buffer == NULL) {
+		printf ("%s: couldn't allocate buffer\n", name);
+		return false;
+	}
+
+	memset (buffer, 0, DISK_SECTOR_SIZE);
+	memcpy (buffer, "GET", 4);
+	((int32_t *) buffer)[1] = size;
+	disk_write (dst, get_sector++, buffer);
+
+	while (size > 0) {
+		size_t chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
+		memcpy (buffer, src, chunk_size);
+		memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
+		disk_write (dst, get_sector++, buffer);
+		src += chunk_size;
+		size -= chunk_size;
+	}
+
+	free (buffer);
+	return true;
+}
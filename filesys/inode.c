@@ -1,4 +1,5 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
@@ -6,6 +7,9 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -34,8 +38,21 @@ struct inode {
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+	struct lock text_lock;              /* Protects text_pages. */
+	struct hash *text_pages;            /* struct text_page, or NULL. */
 };
 
+/* A read-only page of an executable, shared by every process that
+ * maps it.  See inode_get_text_page(). */
+struct text_page {
+	struct hash_elem elem;              /* Element in `text_pages'. */
+	off_t ofs;                          /* File offset of the page. */
+	size_t read_bytes;                  /* Bytes read from there. */
+	void *kpage;                        /* The page, from the user pool. */
+};
+
+static void text_pages_drop (struct inode *);
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
@@ -50,13 +67,19 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  Most opens find the inode
+ * already there, so lookups take open_inodes_lock for reading and
+ * only adding or removing an inode takes it for writing. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+static struct inode *open_inodes_find (disk_sector_t);
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	rwlock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -101,23 +124,26 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
 	struct inode *inode;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
-	}
+	rwlock_acquire_read (&open_inodes_lock);
+	inode = inode_reopen (open_inodes_find (sector));
+	rwlock_release_read (&open_inodes_lock);
+	if (inode != NULL)
+		return inode;
+
+	/* Check again, since another thread may have opened it
+	   while we held no lock. */
+	rwlock_acquire_write (&open_inodes_lock);
+	inode = inode_reopen (open_inodes_find (sector));
+	if (inode != NULL)
+		goto done;
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
 	if (inode == NULL)
-		return NULL;
+		goto done;
 
 	/* Initialize. */
 	list_push_front (&open_inodes, &inode->elem);
@@ -125,15 +151,36 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	lock_init (&inode->text_lock);
+	inode->text_pages = NULL;
 	disk_read (filesys_disk, inode->sector, &inode->data);
+
+done:
+	rwlock_release_write (&open_inodes_lock);
 	return inode;
 }
 
-/* Reopens and returns INODE. */
+/* Returns the open inode for SECTOR, or a null pointer if it is
+ * not open.  open_inodes_lock must be held. */
+static struct inode *
+open_inodes_find (disk_sector_t sector) {
+	struct list_elem *e;
+
+	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+			e = list_next (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector)
+			return inode;
+	}
+	return NULL;
+}
+
+/* Reopens and returns INODE.  The count is updated atomically,
+ * since readers of open_inodes reopen concurrently. */
 struct inode *
 inode_reopen (struct inode *inode) {
 	if (inode != NULL)
-		inode->open_cnt++;
+		__atomic_fetch_add (&inode->open_cnt, 1, __ATOMIC_RELAXED);
 	return inode;
 }
 
@@ -153,9 +200,12 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
+	rwlock_acquire_write (&open_inodes_lock);
+	if (__atomic_sub_fetch (&inode->open_cnt, 1, __ATOMIC_RELAXED) == 0) {
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
+		rwlock_release_write (&open_inodes_lock);
+		text_pages_drop (inode);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
@@ -165,7 +215,8 @@ inode_close (struct inode *inode) {
 		}
 
 		free (inode); 
-	}
+	} else
+		rwlock_release_write (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -239,6 +290,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
 	if (inode->deny_write_cnt)
 		return 0;
+	text_pages_drop (inode);
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -311,3 +363,103 @@ off_t
 inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
+
+static uint64_t
+text_page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct text_page *tp = hash_entry (e, struct text_page, elem);
+	return hash_int (tp->ofs);
+}
+
+static bool
+text_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct text_page *a = hash_entry (a_, struct text_page, elem);
+	const struct text_page *b = hash_entry (b_, struct text_page, elem);
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Returns a user page holding the READ_BYTES bytes of INODE at
+ * offset OFS, followed by zeros, to map read-only.  Every caller
+ * asking for the same page of INODE gets the same page, which is
+ * read from disk only the first time, so that all processes
+ * running one executable share its text.  The caller receives a
+ * share of the page, to drop with palloc_free_page(); INODE keeps
+ * a share of its own until it is written to or closed for the last
+ * time.  Returns a null pointer if memory is exhausted or the page
+ * cannot be read. */
+void *
+inode_get_text_page (struct inode *inode, off_t ofs, size_t read_bytes) {
+	struct text_page key, *tp = NULL;
+	struct hash_elem *e;
+	void *kpage = NULL;
+
+	ASSERT (ofs % PGSIZE == 0);
+	ASSERT (read_bytes <= PGSIZE);
+
+	lock_acquire (&inode->text_lock);
+	if (inode->text_pages == NULL) {
+		inode->text_pages = malloc (sizeof *inode->text_pages);
+		if (inode->text_pages == NULL
+				|| !hash_init (inode->text_pages, text_page_hash, text_page_less,
+					NULL)) {
+			free (inode->text_pages);
+			inode->text_pages = NULL;
+			goto done;
+		}
+	}
+
+	key.ofs = ofs;
+	key.read_bytes = read_bytes;
+	e = hash_find (inode->text_pages, &key.elem);
+	if (e != NULL)
+		tp = hash_entry (e, struct text_page, elem);
+	else {
+		tp = malloc (sizeof *tp);
+		if (tp == NULL)
+			goto done;
+		tp->kpage = palloc_get_page (PAL_USER);
+		if (tp->kpage == NULL
+				|| inode_read_at (inode, tp->kpage, read_bytes, ofs)
+				   != (off_t) read_bytes) {
+			if (tp->kpage != NULL)
+				palloc_free_page (tp->kpage);
+			free (tp);
+			goto done;
+		}
+		memset ((uint8_t *) tp->kpage + read_bytes, 0, PGSIZE - read_bytes);
+		tp->ofs = ofs;
+		tp->read_bytes = read_bytes;
+		hash_insert (inode->text_pages, &tp->elem);
+	}
+	kpage = tp->kpage;
+	palloc_share_page (kpage);
+
+done:
+	lock_release (&inode->text_lock);
+	return kpage;
+}
+
+static void
+text_page_free (struct hash_elem *e, void *aux UNUSED) {
+	struct text_page *tp = hash_entry (e, struct text_page, elem);
+	palloc_free_page (tp->kpage);
+	free (tp);
+}
+
+/* Drops INODE's shares of its text pages.  Pages still mapped by
+ * a process stay until it unmaps them, but are no longer handed
+ * out. */
+static void
+text_pages_drop (struct inode *inode) {
+	if (inode->text_pages == NULL)
+		return;
+	lock_acquire (&inode->text_lock);
+	if (inode->text_pages != NULL) {
+		hash_destroy (inode->text_pages, text_page_free);
+		free (inode->text_pages);
+		inode->text_pages = NULL;
+	}
+	lock_release (&inode->text_lock);
+}
@@ -2,22 +2,32 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Tickless idle mode, set by kernel command-line option
+   "-tickless". */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
 void timer_sleep (int64_t ticks);
+void timer_block_until (int64_t wakeup);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
+void timer_intr_stats (int64_t *cnt, uint64_t *cycles);
 
 #endif /* devices/timer.h */
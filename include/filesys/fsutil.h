@@ -1,10 +1,14 @@
 #ifndef FILESYS_FSUTIL_H
 #define FILESYS_FSUTIL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 void fsutil_ls (char **argv);
 void fsutil_cat (char **argv);
 void fsutil_rm (char **argv);
 void fsutil_put (char **argv);
 void fsutil_get (char **argv);
+bool fsutil_get_buffer (const char *name, const void *data, size_t size);
 
 #endif /* filesys/fsutil.h */
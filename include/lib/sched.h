@@ -0,0 +1,32 @@
+#ifndef __LIB_SCHED_H
+#define __LIB_SCHED_H
+
+/* Scheduling classes.  A ready thread of a higher class always
+   runs before any thread of a lower one. */
+enum sched_class {
+	SCHED_NORMAL,               /* Priority or 4.4BSD scheduling. */
+	SCHED_FIFO,                 /* Fixed priority, no time slice. */
+	SCHED_DEADLINE,             /* Earliest deadline first, with a
+	                               CPU budget per period. */
+};
+
+/* Range of SCHED_FIFO priorities.  User programs may use up to
+   SCHED_FIFO_PRI_USER_MAX; the priorities above it are kept for
+   kernel threads that must never wait behind a user program. */
+#define SCHED_FIFO_PRI_MIN 0
+#define SCHED_FIFO_PRI_MAX 63
+#define SCHED_FIFO_PRI_USER_MAX (SCHED_FIFO_PRI_MAX - 1)
+
+/* Scheduling class and parameters, passed to the sched_setattr
+   system call. */
+struct sched_attr {
+	int sched_class;            /* A `enum sched_class'. */
+	int priority;               /* SCHED_FIFO priority. */
+	int runtime;                /* SCHED_DEADLINE budget per period,
+	                               in timer ticks. */
+	int period;                 /* SCHED_DEADLINE period, which is
+	                               also the relative deadline, in
+	                               timer ticks. */
+};
+
+#endif /* lib/sched.h */
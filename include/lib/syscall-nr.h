@@ -36,6 +36,24 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra: scheduler statistics. */
+	SYS_THREAD_STATS,           /* Read this thread's CPU accounting. */
+
+	/* Extra: user-space synchronization. */
+	SYS_FUTEX_WAIT,             /* Sleep while a word holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+
+	/* Extra: user threads. */
+	SYS_UTHREAD_CREATE,         /* Start a thread in this process. */
+	SYS_UTHREAD_JOIN,           /* Wait for a thread to exit. */
+	SYS_UTHREAD_EXIT,           /* Exit this thread. */
+
+	/* Extra: real-time scheduling. */
+	SYS_SCHED_SETATTR,          /* Set this thread's scheduling class. */
+
+	/* Extra: resource limits. */
+	SYS_SET_STACK_LIMIT,        /* Set how far the stack may grow. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+/* Number of buckets in a thread's ready-to-run wait histogram.
+   Bucket I counts waits of 2**I to 2**(I+1) - 1 TSC cycles, and
+   the last bucket also counts every longer wait. */
+#define THREAD_WAIT_BUCKETS 40
+
+/* Per-thread CPU accounting, kept by the scheduler and returned
+   to user programs by the thread_stats system call. */
+struct thread_stats {
+	long long user_ticks;       /* # of timer ticks in user mode. */
+	long long kernel_ticks;     /* # of timer ticks in kernel mode. */
+	long long voluntary_switches;   /* # of times it blocked. */
+	long long involuntary_switches; /* # of times it was switched
+	                                   out while still ready. */
+	long long wait_hist[THREAD_WAIT_BUCKETS]; /* Ready-to-run waits. */
+};
+
+#endif /* lib/thread-stats.h */
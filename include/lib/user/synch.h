@@ -0,0 +1,39 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutexes and condition variables for user programs, built on
+   the futex_wait() and futex_wake() system calls.  They live in
+   ordinary memory, so processes that share a mapping can share
+   them.  Locking a free mutex, and unlocking one nobody waits
+   for, never enter the kernel. */
+
+/* A mutex.  `state' is 0 if unlocked, 1 if locked with no
+   waiters, and 2 if locked with possible waiters. */
+struct mutex {
+	unsigned state;
+};
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* A condition variable.  Waiters sleep on `seq', which every
+   signal or broadcast bumps. */
+struct condvar {
+	unsigned seq;               /* Bumped by each signal. */
+	unsigned waiters;           /* # of threads in cond_wait(). */
+};
+
+#define CONDVAR_INITIALIZER { 0, 0 }
+
+void cond_init (struct condvar *);
+void cond_wait (struct condvar *, struct mutex *);
+void cond_signal (struct condvar *);
+void cond_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <sched.h>
+#include <thread-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -38,6 +40,24 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+/* Extra: scheduler statistics. */
+void get_thread_stats (struct thread_stats *);
+
+/* Extra: user-space synchronization. */
+int futex_wait (unsigned *addr, unsigned expected);
+int futex_wake (unsigned *addr, int cnt);
+
+/* Extra: user threads. */
+int uthread_create (int (*fn) (void *), void *arg);
+int uthread_join (int tid);
+void uthread_exit (int status) NO_RETURN;
+
+/* Extra: real-time scheduling. */
+int sched_setattr (const struct sched_attr *);
+
+/* Extra: resource limits. */
+int set_stack_limit (size_t bytes);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
@@ -0,0 +1,79 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+struct thread;
+
+/* Maximum number of CPUs the kernel keeps state for. */
+#define CPU_MAX 8
+
+/* Number of run queue levels, one per thread priority. */
+#define RQ_LEVELS 64
+
+/* Run queue of threads in THREAD_READY state, that is, threads
+   that are ready to run on a CPU but not actually running.  There
+   is one FIFO list per priority level, and bit P of `mask' is set
+   exactly when levels[P] is non-empty, so the highest ready
+   priority is found with a single bit scan.  SCHED_FIFO threads
+   have levels of their own, the same way, and SCHED_DEADLINE
+   threads a single list in deadline order. */
+struct run_queue {
+  struct spinlock lock;             /* Protects the members below. */
+  struct list levels[RQ_LEVELS];    /* Ready threads, by priority. */
+  uint64_t mask;                    /* Non-empty levels. */
+  struct list fifo_levels[RQ_LEVELS]; /* SCHED_FIFO threads. */
+  uint64_t fifo_mask;               /* Non-empty fifo_levels. */
+  struct list deadline;             /* SCHED_DEADLINE threads. */
+  int cnt;                          /* # of threads in all lists. */
+};
+
+/* Per-CPU state.
+
+   Only the bootstrap processor (BSP) is brought online, so
+   cpu_cnt is always 1.  Starting the application processors
+   (INIT/SIPI, per-CPU GDT, TSS and local APIC timer, -smp in
+   utils/pintos) has to wait until the rest of the kernel stops
+   relying on intr_disable() for mutual exclusion, which only
+   excludes code running on the same CPU.  Until then nothing
+   moves threads between CPUs.
+
+   The scheduler keeps its per-processor state here all the
+   same, so that the code that uses it need not change when more
+   CPUs come online. */
+struct cpu {
+  int id;                       /* Index into cpus[]. */
+
+  /* Owned by thread.c. */
+  struct run_queue rq;          /* Threads waiting for this CPU. */
+  struct thread *curr;          /* Thread running on this CPU. */
+  struct thread *idle_thread;   /* Runs when `rq' is empty. */
+  unsigned thread_ticks;        /* # of timer ticks since last yield. */
+  long long idle_ticks;         /* # of timer ticks spent idle. */
+  long long kernel_ticks;       /* # of timer ticks in kernel mode. */
+  long long user_ticks;         /* # of timer ticks in user mode. */
+  int64_t rt_period_end;        /* End of the user SCHED_FIFO period. */
+  int rt_ticks;                 /* # of its ticks used by user SCHED_FIFO. */
+
+  /* Owned by interrupt.c. */
+  bool in_external_intr;        /* Processing an external interrupt? */
+  bool in_softirq;              /* Running work from intr_defer()? */
+  bool yield_on_return;         /* Yield on interrupt return? */
+  struct list softirqs;         /* Work from intr_defer(). */
+
+  /* Owned by workqueue.c. */
+  struct spinlock work_lock;    /* Protects `work'. */
+  struct list work;             /* Work from work_queue(). */
+  struct semaphore work_ready;  /* Upped once per item in `work'. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+void cpu_init (struct thread *initial);
+struct cpu *this_cpu (void);
+
+#endif /* threads/cpu.h */
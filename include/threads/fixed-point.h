@@ -0,0 +1,82 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, used by the 4.4BSD
+   scheduler for `recent_cpu' and `load_avg'.  The kernel does not
+   support floating point, so real numbers are stored as integers
+   scaled by F = 2**14.  See the "Fixed-Point Real Arithmetic"
+   section of the project 1 documentation. */
+typedef int fixed_t;
+
+#define FP_Q 14                 /* Number of fraction bits. */
+#define FP_F (1 << FP_Q)        /* Fixed-point 1. */
+
+/* Converts integer N to fixed point. */
+static inline fixed_t
+int_to_fp (int n) {
+  return n * FP_F;
+}
+
+/* Converts X to integer, rounding toward zero. */
+static inline int
+fp_to_int (fixed_t x) {
+  return x / FP_F;
+}
+
+/* Converts X to integer, rounding to nearest. */
+static inline int
+fp_to_int_round (fixed_t x) {
+  return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+/* Returns X + Y. */
+static inline fixed_t
+fp_add (fixed_t x, fixed_t y) {
+  return x + y;
+}
+
+/* Returns X - Y. */
+static inline fixed_t
+fp_sub (fixed_t x, fixed_t y) {
+  return x - y;
+}
+
+/* Returns X + N. */
+static inline fixed_t
+fp_add_int (fixed_t x, int n) {
+  return x + n * FP_F;
+}
+
+/* Returns X - N. */
+static inline fixed_t
+fp_sub_int (fixed_t x, int n) {
+  return x - n * FP_F;
+}
+
+/* Returns X * Y. */
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y) {
+  return ((int64_t) x) * y / FP_F;
+}
+
+/* Returns X * N. */
+static inline fixed_t
+fp_mul_int (fixed_t x, int n) {
+  return x * n;
+}
+
+/* Returns X / Y. */
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y) {
+  return ((int64_t) x) * FP_F / y;
+}
+
+/* Returns X / N. */
+static inline fixed_t
+fp_div_int (fixed_t x, int n) {
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
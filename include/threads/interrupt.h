@@ -65,12 +65,15 @@ struct intr_frame {
 
 typedef void intr_handler_func (struct intr_frame *);
 
+struct work;
+
 void intr_init (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
+bool intr_defer (struct work *);
 
 void intr_dump_frame (const struct intr_frame *);
 void SCW_dump_frame (const struct intr_frame *);
@@ -0,0 +1,67 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Sampling profiler.
+
+   With kernel command-line option "-profile", every timer
+   interrupt records where the CPU it hit was running into that
+   CPU's sample buffer; with "-profile=stack", it also records
+   the kernel call stack there, found by following frame
+   pointers.  Once a buffer is full, further samples are only
+   counted.  At power-off the buffers are written to the scratch
+   disk in the format below, where "pintos --profile FILE" picks
+   them up for "backtrace --flat" or "backtrace --folded". */
+
+/* Maximum number of addresses in one sample. */
+#define PROFILE_DEPTH 15
+
+/* One sample: the interrupted rip, followed, in stack mode, by
+   the return addresses of the kernel functions it was nested
+   within, innermost first. */
+struct profile_sample {
+	uint32_t depth;             /* # of entries in `pcs'. */
+	uint32_t user;              /* Nonzero if rip is in user mode. */
+	uint64_t pcs[PROFILE_DEPTH];
+};
+
+/* Number of samples each CPU's buffer holds. */
+#define PROFILE_SAMPLES 2048
+
+/* One CPU's sample buffer. */
+struct profile_cpu {
+	uint64_t taken;             /* # of samples in `samples'. */
+	uint64_t dropped;           /* # of samples that did not fit. */
+	uint64_t reserved[2];
+	struct profile_sample samples[PROFILE_SAMPLES];
+};
+
+/* Start of a profile dump, followed by `cpu_cnt' struct
+   profile_cpus. */
+struct profile_header {
+	char magic[8];              /* "PPROF1". */
+	uint32_t cpu_cnt;           /* # of profile_cpus that follow. */
+	uint32_t samples_per_cpu;   /* PROFILE_SAMPLES. */
+	uint32_t depth;             /* PROFILE_DEPTH. */
+	uint32_t timer_freq;        /* Samples per second per CPU. */
+	uint64_t reserved;
+};
+
+/* Profiling modes, set by kernel command-line option
+   "-profile". */
+enum profile_mode {
+	PROFILE_OFF,                /* Not profiling. */
+	PROFILE_PC,                 /* Record the interrupted rip. */
+	PROFILE_STACK,              /* Also record the kernel call stack. */
+};
+extern enum profile_mode profile_mode;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+
+#endif /* threads/profile.h */
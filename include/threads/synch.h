@@ -1,13 +1,30 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* An entry in a priority-ordered wait queue: a thread waiting on
+   a semaphore, or a semaphore_elem waiting on a condition.  The
+   queue is a heap ordered by `priority', highest first, with
+   ties broken by `seq' so that equal priorities wake up in FIFO
+   order.  `priority' is a copy of the waiting thread's priority,
+   updated through sema_waiter_requeue() whenever that changes. */
+struct prio_waiter {
+	struct heap_elem elem;      /* Heap element. */
+	int priority;               /* Priority of the waiting thread. */
+	uint64_t seq;               /* Arrival order. */
+	struct heap *queue;         /* Queue it is in, or NULL. */
+};
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads' `sema_waiter's. */
 };
 
 /* One semaphore in a list. */
@@ -16,7 +33,7 @@ struct semaphore {
  - 문제가 될 수있음 따라서 구조체를 이동
 */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct prio_waiter waiter;          /* Entry in condition's waiters. */
 	struct semaphore semaphore;         /* This semaphore. */
 };
 
@@ -25,11 +42,25 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
+void sema_waiter_requeue (struct thread *);
+
+/* Lock contention statistics.  Updated only by the thread that
+   has just acquired the lock, so the lock itself protects them. */
+struct lock_stats {
+	long long acquires;         /* # of successful acquisitions. */
+	long long contended;        /* # of those that found it held. */
+	uint64_t spin_cycles;       /* TSC cycles spent spinning;
+	                               0 with a single CPU. */
+	uint64_t block_cycles;      /* TSC cycles spent blocked. */
+};
 
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int max_pri;                /* Highest priority of waiting threads. */
+	struct list_elem held_elem; /* Element in holder's `held_locks'. */
+	struct lock_stats stats;    /* Contention statistics. */
 };
 
 void lock_init (struct lock *);
@@ -37,10 +68,62 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (const struct lock *, const char *name);
+
+/* Readers-writer lock.  Any number of threads may hold it for
+   reading at once, or a single thread for writing.  Writers are
+   preferred: once a writer is waiting, new readers wait behind
+   it, so a steady stream of readers cannot starve writers.
+
+   Writers queue up on `lock', which a writer keeps held while it
+   waits for the current readers to leave and while it writes, so
+   waiting writers and readers donate priority to it as usual.  A
+   writer waiting for readers donates its priority to each of
+   them in turn. */
+struct rwlock {
+	struct lock lock;           /* Held by the writer. */
+	int readers;                /* # of threads holding for reading. */
+	struct list reader_holds;   /* Their `struct rwlock_hold's. */
+	struct list read_waiters;   /* Threads waiting to read. */
+	struct thread *drainer;     /* Writer waiting for readers to leave. */
+};
+
+/* Maximum number of readers-writer locks a thread may hold for
+   reading at once. */
+#define RWLOCK_NEST_MAX 4
+
+/* One read hold of a readers-writer lock, kept in the holding
+   thread's struct thread. */
+struct rwlock_hold {
+	struct rwlock *rwlock;      /* Lock held for reading, or NULL. */
+	struct thread *thread;      /* Holding thread. */
+	struct list_elem elem;      /* Element in rwlock's `reader_holds'. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
+/* Spinlock.  Protects data shared between CPUs for very short
+   critical sections.  Interrupts must be off while a spinlock is
+   held, so that the holder can be neither preempted nor
+   interrupted by code that takes the same lock. */
+struct spinlock {
+	volatile int locked;        /* Nonzero while held. */
+	struct cpu *holder;         /* CPU holding lock (for debugging). */
+};
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+bool spinlock_try_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held_by_current_cpu (const struct spinlock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting `semaphore_elem's. */
 };
 
 void cond_init (struct condition *);
@@ -48,9 +131,6 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-//sema의 우선순위를 위해서 추가된 함수
-bool compare_sema_priority (const struct list_elem *,const struct list_elem *, void *);
-
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -2,8 +2,12 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <sched.h>
 #include <stdint.h>
+#include <thread-stats.h>
+#include "threads/fixed-point.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -27,8 +31,11 @@ typedef int tid_t;
 #define PRI_MIN     0  /* Lowest priority. */
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX     63 /* Highest priority. */
-#define FD_COUNT_LIMT 1<<9 /*page 하나의 크기가 1<<12인데 그중 3칸은 페이지 주소를 위해 할당됨 따라서 쓸수있는 크기는 1<<9 까지임*/
-#define FD_PAGES 3
+
+/* Thread niceness, for the 4.4BSD scheduler. */
+#define NICE_MIN     -20 /* Nicest. */
+#define NICE_DEFAULT 0   /* Default. */
+#define NICE_MAX     20  /* Least nice. */
 
 /* A kernel thread or user process.
  *
@@ -93,22 +100,46 @@ struct thread {
   enum thread_status status; /* Thread state. */
   char name[16];             /* Name (for debugging purposes). */
   int priority;              /* Priority. */
+  int ready_pri;             /* Run queue level while THREAD_READY. */
+  struct cpu *cpu;           /* CPU running T, or whose run queue T is on. */
   int64_t tick_s;            /* tick info for time check*/
+  struct heap_elem sleep_elem; /* Element in timer.c sleep heap. */
+  struct thread_stats stats; /* CPU accounting. */
+  uint64_t ready_since;      /* TSC when T last became ready. */
+
+  /* Owned by thread.c, for the real-time scheduling classes. */
+  enum sched_class sched_class; /* Scheduling class. */
+  int fifo_pri;              /* SCHED_FIFO priority. */
+  int normal_pri;            /* `init_pri' to restore on return to
+                                SCHED_NORMAL. */
+  int dl_runtime;            /* SCHED_DEADLINE budget per period. */
+  int dl_period;             /* SCHED_DEADLINE period. */
+  int64_t dl_deadline;       /* Current absolute deadline, in ticks. */
+  int64_t dl_budget;         /* Ticks left to run before it. */
+  int64_t dl_bw;             /* Share of a CPU reserved, see thread.c. */
 
   /* for project 1 -- start */
   int init_pri;
   struct lock *waitLock;
-  struct list dona;
-  struct list_elem dona_elem;
+  struct list held_locks;    /* Locks held, for priority donation. */
+  struct rwlock_hold rd_holds[RWLOCK_NEST_MAX]; /* Readers-writer locks held for reading. */
+  struct prio_waiter sema_waiter;   /* Entry in a semaphore's waiters. */
+  struct prio_waiter *cond_waiter;  /* Entry in a condition's waiters. */
   /* for project 1 -- end */
 
+  /* Owned by thread.c, for the 4.4BSD scheduler. */
+  int nice;                    /* Niceness. */
+  fixed_t recent_cpu;          /* Recently used CPU time. */
+  bool mlfqs_dirty;            /* On the priority update list? */
+  struct list_elem dirty_elem; /* Priority update list element. */
+  struct list_elem allelem;    /* List element for all threads list. */
+
   /* Shared between thread.c and synch.c. */
   struct list_elem elem; /* List element. */
 
   /* for project 2 -- start */
   int exit_status; // 현재 파일의 status를 확인하기 위해서
-  struct file **fd_table; // 프로세서는 파일 디스크립터를 관리하는 테이블이 필요함
-  int fd_idx; // 그리고 그 파일 디스크립터 테이블에 들어가는 파일 디스크립터의 인덱스를 저장
+  struct fd_table *fd_table; // 프로세서는 파일 디스크립터를 관리하는 테이블이 필요함 (kernel thread는 NULL)
 
   struct list child_s;
   struct list_elem child_elem;
@@ -124,15 +155,26 @@ struct thread {
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
   uint64_t *pml4; /* Page map level 4 */
+  struct image *image; /* Segments to load pages from on demand. */
+  uintptr_t user_rsp;  /* User stack pointer at the last system call. */
+  size_t stack_limit;  /* Bytes the stack may grow to below USER_STACK;
+                          0 in threads made by uthread_spawn(), whose
+                          stacks do not grow. */
+
+  /* Owned by userprog/uthread.c. */
+  struct uthread_group *group; /* This process's threads, or NULL. */
+  struct uthread *uthread;     /* Join record, NULL in a main thread. */
 
 #endif
 #ifdef VM
-  /* Table for whole virtual memory owned by thread. */
-  struct supplemental_page_table spt;
+  /* Table for whole virtual memory of the process, shared by its
+     threads like pml4.  Owned by userprog/process.c. */
+  struct supplemental_page_table *spt;
 #endif
 
   /* Owned by thread.c. */
-  struct intr_frame tf; /* Information for switching */
+  struct intr_frame tf; /* Context to start a new thread from. */
+  uint64_t *switch_rsp; /* Saved stack pointer, or NULL if never run. */
   unsigned magic;       /* Detects stack overflow. */
 };
 
@@ -144,7 +186,8 @@ extern bool thread_mlfqs;
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (const struct intr_frame *);
+void thread_add_idle_ticks (int64_t ticks);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -162,6 +205,7 @@ void thread_yield (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+bool thread_set_sched (const struct sched_attr *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -169,13 +213,16 @@ int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 void do_iret (struct intr_frame *tf);
 
+size_t thread_cache_reclaim (void);
+void thread_cache_set_max (int max);
+
 void test_max_priority (void);
 bool compare_priority (const struct list_elem *input,
                        const struct list_elem *prev, void *aux UNUSED);
 
 /* Implement for Priority Donation */
 void dona_priority (void);
-void remove_lock (struct lock *lock);
+void thread_donate (struct thread *, int priority);
 void refresh_pri (void);
 
 #endif /* threads/thread.h */
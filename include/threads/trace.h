@@ -0,0 +1,73 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   With kernel command-line option "-trace", every CPU records
+   kernel events into its own fixed-size ring buffer, overwriting
+   the oldest ones when it fills up.  Recording only disables
+   interrupts on the local CPU, so it takes no lock and is cheap
+   enough to leave in hot paths.  At power-off the buffers are
+   written to the scratch disk in the format below, where
+   "pintos --trace FILE" picks them up for utils/trace-decode. */
+
+/* Events.  The meaning of each event's two arguments is given
+   after its name. */
+enum trace_type {
+	TRACE_SCHEDULE = 1,         /* Prev tid, next tid. */
+	TRACE_BLOCK,                /* -, -. */
+	TRACE_UNBLOCK,              /* Unblocked tid, -. */
+	TRACE_SEMA_DOWN,            /* Semaphore address, its value. */
+	TRACE_SEMA_UP,              /* Semaphore address, woken tid or 0. */
+	TRACE_PAGE_FAULT,           /* Fault address, error code. */
+	TRACE_SYSCALL_ENTER,        /* Syscall number, first argument. */
+	TRACE_SYSCALL_EXIT,         /* Syscall number, return value. */
+	TRACE_DISK_READ,            /* Disk number, sector. */
+	TRACE_DISK_WRITE,           /* Disk number, sector. */
+};
+
+/* One recorded event. */
+struct trace_event {
+	uint64_t tsc;               /* rdtsc() when recorded. */
+	uint16_t type;              /* A `enum trace_type'. */
+	uint16_t reserved;
+	int32_t tid;                /* Running thread, or 0. */
+	uint64_t arg0, arg1;        /* Event-specific. */
+};
+
+/* Number of events each CPU's ring buffer holds. */
+#define TRACE_EVENTS 2048
+
+/* One CPU's ring buffer.  Event I is in events[I % TRACE_EVENTS],
+   so once more than TRACE_EVENTS have been written, the oldest
+   one is at events[written % TRACE_EVENTS]. */
+struct trace_cpu {
+	uint64_t written;           /* # of events ever recorded. */
+	uint64_t reserved[3];
+	struct trace_event events[TRACE_EVENTS];
+};
+
+/* Start of a trace dump, followed by `cpu_cnt' struct trace_cpus.
+   The TSC and tick readings at the start and end of tracing let
+   the decoder turn TSC cycles into time. */
+struct trace_header {
+	char magic[8];              /* "PTRACE1". */
+	uint32_t cpu_cnt;           /* # of trace_cpus that follow. */
+	uint32_t events_per_cpu;    /* TRACE_EVENTS. */
+	uint32_t timer_freq;        /* TIMER_FREQ. */
+	uint32_t reserved;
+	uint64_t start_tsc, end_tsc;
+	int64_t start_ticks, end_ticks;
+};
+
+/* Set by kernel command-line option "-trace". */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_record (enum trace_type, uint64_t arg0, uint64_t arg1);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
@@ -0,0 +1,42 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Deferred work.
+
+   An external interrupt handler runs with interrupts off, so
+   everything it does delays every other interrupt on its CPU.
+   Handlers should do only what the hardware needs right away
+   and defer the rest as a `struct work', in one of two ways:
+
+   - intr_defer() runs the work as soon as the interrupt has
+     been acknowledged, before it returns, with interrupts back
+     on.  It still runs in interrupt context, so it may not
+     sleep.
+
+   - work_queue() hands the work to the CPU's worker thread, a
+     kernel thread at PRI_MAX, so it may sleep.
+
+   Each CPU keeps its own queues.  Queuing work that is already
+   queued does nothing, so one deferral may stand for several
+   requests: work must check for everything it may have to
+   do. */
+
+/* Function that performs deferred work. */
+typedef void work_func (void *aux);
+
+/* A unit of deferred work. */
+struct work {
+	struct list_elem elem;      /* In a CPU's softirq or work list. */
+	work_func *func;            /* Function to call... */
+	void *aux;                  /* ...and its argument. */
+	bool pending;               /* Queued and not yet started? */
+};
+
+void work_init (struct work *, work_func *, void *aux);
+void workqueue_init (void);
+bool work_queue (struct work *);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,44 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdint.h>
+#include "threads/synch.h"
+
+struct file;
+
+/* Maximum number of file descriptors per process. */
+#define FD_COUNT_LIMT (1 << 9)
+
+/* File descriptors 0 and 1 are the console.  Their slots hold
+   these markers instead of files, and they are never handed out
+   by fd_table_add(). */
+#define FD_STDIN_MARKER  ((struct file *) 1)
+#define FD_STDOUT_MARKER ((struct file *) 2)
+
+/* A process's file descriptor table.  It starts with room for
+   FD_TABLE_MIN descriptors and doubles whenever it fills up, up to
+   FD_COUNT_LIMT.  Bit FD of `used' is set exactly when files[FD]
+   is in use, so the lowest free descriptor is found by scanning
+   a few words rather than every slot.
+
+   The threads of a process share its table.  A system call holds
+   `lock' from looking a descriptor up until it is done with the
+   file, so that another thread cannot close the file under it;
+   fd_table_add(), fd_table_get() and fd_table_remove() must be
+   called with it held. */
+struct fd_table {
+  struct lock lock;      /* Guards the table and its files' use. */
+  struct file **files;   /* files[FD] is the file open as FD. */
+  uint64_t *used;        /* Bitmap of descriptors in use. */
+  int cap;               /* # of slots in `files'. */
+  int first_free;        /* No descriptor below this one is free. */
+};
+
+struct fd_table *fd_table_create (void);
+struct fd_table *fd_table_duplicate (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+int fd_table_add (struct fd_table *, struct file *);
+struct file *fd_table_get (struct fd_table *, int fd);
+struct file *fd_table_remove (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
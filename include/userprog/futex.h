@@ -0,0 +1,26 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+/* Futexes: blocking on a 32-bit word in user memory.
+
+   A waiter is identified by its process's page table and the
+   user address of the word it waits on, which the threads of a
+   process share, and which stay the same while the word's page
+   is swapped out or copied on write.  Waiters hash into one of
+   FUTEX_BUCKETS buckets by that key, each with its own lock.
+
+   Futexes synchronize the threads of one process only.  This
+   kernel has no memory that processes share: fork() copies on
+   write and there is no mmap().  Were there, a word in a shared
+   file mapping would have to be keyed by its file and offset. */
+
+void futex_init (void);
+int futex_wait (uint32_t *uaddr, uint32_t expected);
+int futex_wake (uint32_t *uaddr, int cnt);
+
+struct uthread_group;
+void futex_wake_group (const struct uthread_group *);
+
+#endif /* userprog/futex.h */
@@ -3,6 +3,12 @@
 
 #include "threads/thread.h"
 
+/* Default and largest limits on how far a process's stack may grow
+   down from USER_STACK.  The page just below the limit is a guard
+   page that is never mapped. */
+#define STACK_LIMIT_DEFAULT (1 << 20)
+#define STACK_LIMIT_MAX (8 << 20)
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
@@ -10,5 +16,14 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
 struct thread *get_child(int pid);
+bool process_stack_access (const void *addr, uintptr_t rsp);
+bool process_page_writable (const void *addr);
+#ifndef VM
+bool process_handle_cow (void *va);
+bool process_load_page (void *va);
+bool process_grow_stack (void *addr);
+#else
+bool setup_stack (struct intr_frame *if_);
+#endif
 
 #endif /* userprog/process.h */
@@ -8,7 +8,7 @@
 #define USERPROG_SYSCALL_H
 
 void syscall_init (void);
-void check_add (void *add);
+void check_address (void *add);
 void halt_handler (void);
 void exit_handler (int status);
 tid_t fork_handler (const char *thread_name, struct intr_frame *f);
@@ -27,9 +27,17 @@ int write_handler (int fd, const void *buffer, unsigned size);
 void seek_handler (int fd, unsigned position);
 unsigned tell_handler (int fd);
 void close_handler (int fd);
+void thread_stats_handler (struct thread_stats *stats);
+int futex_wait_handler (uint32_t *uaddr, uint32_t expected);
+int futex_wake_handler (uint32_t *uaddr, int cnt);
+tid_t uthread_create_handler (void *entry, void *fn, void *arg);
+int uthread_join_handler (tid_t tid);
+void uthread_exit_handler (int status);
+int sched_setattr_handler (const struct sched_attr *attr);
+int set_stack_limit_handler (size_t bytes);
 void remove_fd_in_FDT(int fd);
 
-struct lock filesys_lock;
+extern struct lock filesys_lock;
 
 
 #endif /* userprog/syscall.h */
@@ -0,0 +1,32 @@
+#ifndef USERPROG_UTHREAD_H
+#define USERPROG_UTHREAD_H
+
+#include <stdbool.h>
+#include "threads/thread.h"
+
+/* User threads: extra threads in a user process, sharing its
+   page table and file descriptor table.
+
+   The thread that runs a process's main() is its main thread.
+   uthread_spawn() starts another thread of the same process on
+   a stack of its own, below the main thread's.  A process keeps
+   running until its main thread exits.  exit() from any of its
+   threads ends the whole process.  Before the main thread frees
+   the process's resources, it waits for every other thread to
+   stop.  Those threads stop the next time they enter the kernel
+   or the kernel interrupts them in user mode.  A thread asleep in
+   futex_wait() is woken up to stop.  One blocked anywhere else
+   finishes that call first, so a thread that blocks for good, say
+   in read() from the keyboard, keeps its process from exiting;
+   see uthread_group_exit(). */
+
+tid_t uthread_spawn (void *entry, void *fn, void *arg);
+int uthread_wait (tid_t);
+bool uthread_exiting (void);
+void uthread_check_exit (void);
+void uthread_exit_process (int status);
+bool uthread_exec_prepare (void);
+void uthread_release (struct thread *);
+void uthread_group_exit (struct thread *);
+
+#endif /* userprog/uthread.h */
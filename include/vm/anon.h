@@ -1,13 +1,22 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
 enum vm_type;
 
 struct anon_page {
+	size_t swap_index;      /* Swap slot holding the page while it is
+	                           swapped out, otherwise BITMAP_ERROR. */
 };
 
+/* Most anonymous pages that vm_evict_frame() swaps out at once. */
+#define SWAP_CLUSTER 8
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t anon_swap_out_cluster (struct page *pages[], size_t cnt);
+void anon_read_swapped (struct page *page, void *kva);
+void swap_print_stats (void);
 
 #endif
@@ -6,11 +6,24 @@
 struct page;
 enum vm_type;
 
+/* Where the data of a page backed by a file lies: READ_BYTES
+ * bytes of FILE from OFS on, followed by zeros up to the end of
+ * the page.  A page loaded lazily from a file gets a malloc'd copy
+ * of this as its uninit aux.
+ * A TEXT page is a read-only page of an executable.  It is never
+ * read into a frame of its own, but maps the page every process
+ * running the executable shares; see inode_get_text_page(). */
 struct file_page {
+	struct file *file;
+	off_t ofs;
+	size_t read_bytes;
+	bool text;
 };
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_page_read (const struct file_page *fp, void *kva);
+bool file_lazy_load (struct page *page, void *aux);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
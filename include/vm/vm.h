@@ -1,7 +1,11 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <stdint.h>
+#include <hash.h>
+#include <list.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -46,6 +50,10 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	uint64_t *pml4;        /* Page table that maps it while it has a frame */
+	bool writable;         /* May the process write to it? */
+	struct hash_elem hash_elem; /* In its supplemental page table. */
+	struct list_elem frame_elem; /* In its frame's `pages'. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -62,7 +70,10 @@ struct page {
 /* The representation of "frame" */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct page *page;     /* Page it holds, or NULL if free.  The page's
+	                          pml4 tells which process owns it. */
+	struct list pages;     /* Every page it holds: PAGE, and the pages
+	                          fork() shares it with, if any. */
 };
 
 /* The function table for page operations.
@@ -82,9 +93,13 @@ struct page_operations {
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
 /* Representation of current process's memory space.
- * We don't want to force you to obey any specific design for this struct.
- * All designs up to you for this. */
+ * Every page of the process, by user virtual address. */
 struct supplemental_page_table {
+	struct hash spt_hash;  /* struct page, keyed on va. */
+	struct rwlock lock;    /* Held for writing by the process's threads,
+	                          which share the table, to fault pages in
+	                          or add and remove them; for reading just
+	                          to look pages up, or by fork() to copy. */
 };
 
 #include "threads/thread.h"
@@ -96,6 +111,10 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_acquire (struct supplemental_page_table *spt);
+void spt_release (struct supplemental_page_table *spt, bool acquired);
+bool spt_acquire_read (struct supplemental_page_table *spt);
+void spt_release_read (struct supplemental_page_table *spt, bool acquired);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -107,6 +126,7 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_stack_growth (void *addr);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
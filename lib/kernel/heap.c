@@ -0,0 +1,173 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Every element
+   keeps a pointer to its leftmost child and to its right
+   sibling, so the children of a node form a singly linked list.
+   The `prev' link points to the left sibling, or to the parent
+   for the leftmost child, which is what lets heap_remove() unlink
+   an arbitrary element.  The root's `prev' is null.
+
+   Two heaps are combined by "linking" their roots: the larger
+   root becomes the leftmost child of the smaller one.  Removing
+   the root leaves a list of subtrees, which are merged pairwise
+   from left to right and then combined from right to left. */
+
+/* Links the roots A and B, which must not be null and must have
+   no siblings, and returns the new root. */
+static struct heap_elem *
+link (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	if (heap->less (b, a, heap->aux)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	/* B becomes the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+
+	a->prev = a->next = NULL;
+	return a;
+}
+
+/* Merges the sibling list starting at FIRST into a single tree
+   and returns its root, or a null pointer if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root;
+
+	/* First pass: link siblings in pairs, left to right, and
+	   collect the results on a stack threaded through `next'. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		if (b == NULL) {
+			first = NULL;
+			a->prev = a->next = NULL;
+		} else {
+			first = b->next;
+			a->prev = a->next = NULL;
+			b->prev = b->next = NULL;
+			a = link (heap, a, b);
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Second pass: combine the pairs right to left. */
+	root = pairs;
+	if (root != NULL) {
+		pairs = root->next;
+		root->next = NULL;
+		while (pairs != NULL) {
+			struct heap_elem *a = pairs;
+			pairs = a->next;
+			a->next = NULL;
+			root = link (heap, root, a);
+		}
+	}
+	return root;
+}
+
+/* Initializes HEAP as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->elem_cnt = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = heap->root == NULL ? elem : link (heap, heap->root, elem);
+	heap->elem_cnt++;
+}
+
+/* Returns the minimum element in HEAP, or a null pointer if
+   HEAP is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root;
+}
+
+/* Removes and returns the minimum element in HEAP, which must
+   not be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *top;
+
+	ASSERT (heap != NULL);
+	ASSERT (heap->root != NULL);
+
+	top = heap->root;
+	heap->root = merge_pairs (heap, top->child);
+	heap->elem_cnt--;
+
+	top->child = top->next = top->prev = NULL;
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	struct heap_elem *subtree;
+
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	if (elem == heap->root) {
+		heap_pop (heap);
+		return;
+	}
+
+	/* Unlink ELEM from its parent or left sibling. */
+	ASSERT (elem->prev != NULL);
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+
+	/* Merge ELEM's children back in as an independent tree. */
+	subtree = merge_pairs (heap, elem->child);
+	if (subtree != NULL)
+		heap->root = link (heap, heap->root, subtree);
+	heap->elem_cnt--;
+
+	elem->child = elem->next = elem->prev = NULL;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root == NULL;
+}
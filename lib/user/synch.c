@@ -0,0 +1,91 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+static void mutex_lock_contended (struct mutex *);
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m) {
+	m->state = 0;
+}
+
+/* Locks M, sleeping until it is free if need be. */
+void
+mutex_lock (struct mutex *m) {
+	unsigned c = 0;
+
+	if (!__atomic_compare_exchange_n (&m->state, &c, 1, false,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		mutex_lock_contended (m);
+}
+
+/* Locks M if it is free and returns true, or returns false
+   without waiting. */
+bool
+mutex_trylock (struct mutex *m) {
+	unsigned c = 0;
+
+	return __atomic_compare_exchange_n (&m->state, &c, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Locks M, which was found locked.  Marks it as having waiters
+   while sleeping, so that whoever unlocks it wakes one.  Having
+   no way to tell whether others still wait, it stays marked once
+   we get it. */
+static void
+mutex_lock_contended (struct mutex *m) {
+	while (__atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE) != 0)
+		futex_wait (&m->state, 2);
+}
+
+/* Unlocks M, which the caller must have locked, and wakes one
+   waiter if there may be any. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_exchange_n (&m->state, 0, __ATOMIC_RELEASE) == 2)
+		futex_wake (&m->state, 1);
+}
+
+/* Initializes CV with no waiters. */
+void
+cond_init (struct condvar *cv) {
+	cv->seq = 0;
+	cv->waiters = 0;
+}
+
+/* Atomically unlocks M, which the caller must have locked, and
+   waits for CV to be signaled; then locks M again before
+   returning.  As with any condition variable, the caller must
+   recheck its condition, since wakeups may be spurious. */
+void
+cond_wait (struct condvar *cv, struct mutex *m) {
+	unsigned seq;
+
+	__atomic_add_fetch (&cv->waiters, 1, __ATOMIC_SEQ_CST);
+	seq = __atomic_load_n (&cv->seq, __ATOMIC_SEQ_CST);
+	mutex_unlock (m);
+
+	/* Returns at once if a signal came after we read SEQ. */
+	futex_wait (&cv->seq, seq);
+
+	__atomic_sub_fetch (&cv->waiters, 1, __ATOMIC_SEQ_CST);
+	mutex_lock_contended (m);
+}
+
+/* Wakes one thread waiting on CV, if any. */
+void
+cond_signal (struct condvar *cv) {
+	__atomic_add_fetch (&cv->seq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n (&cv->waiters, __ATOMIC_SEQ_CST) != 0)
+		futex_wake (&cv->seq, 1);
+}
+
+/* Wakes every thread waiting on CV. */
+void
+cond_broadcast (struct condvar *cv) {
+	__atomic_add_fetch (&cv->seq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n (&cv->waiters, __ATOMIC_SEQ_CST) != 0)
+		futex_wake (&cv->seq, INT_MAX);
+}
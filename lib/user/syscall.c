@@ -145,6 +145,53 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+void
+get_thread_stats (struct thread_stats *stats) {
+	syscall1 (SYS_THREAD_STATS, stats);
+}
+
+int
+futex_wait (unsigned *addr, unsigned expected) {
+	return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (unsigned *addr, int cnt) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Where a thread made by uthread_create() starts running. */
+static void NO_RETURN
+uthread_start (int (*fn) (void *), void *arg) {
+	uthread_exit (fn (arg));
+}
+
+int
+uthread_create (int (*fn) (void *), void *arg) {
+	return syscall3 (SYS_UTHREAD_CREATE, uthread_start, fn, arg);
+}
+
+int
+uthread_join (int tid) {
+	return syscall1 (SYS_UTHREAD_JOIN, tid);
+}
+
+void
+uthread_exit (int status) {
+	syscall1 (SYS_UTHREAD_EXIT, status);
+	NOT_REACHED ();
+}
+
+int
+sched_setattr (const struct sched_attr *attr) {
+	return syscall1 (SYS_SCHED_SETATTR, attr);
+}
+
+int
+set_stack_limit (size_t bytes) {
+	return syscall1 (SYS_SET_STACK_LIMIT, bytes);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -0,0 +1,105 @@
+/* Puts 1,000 threads to sleep with staggered wake-up times and
+   reports how many TSC cycles the timer interrupt handler spends
+   per tick, first while every sleeper is still pending and then
+   while sleepers are being woken up. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define SLEEPER_CNT 1000
+
+/* Sleepers wake up SLEEPERS_PER_TICK at a time, starting
+   WAKE_DELAY ticks after the test starts. */
+#define SLEEPERS_PER_TICK 4
+#define WAKE_DELAY 200
+
+struct bench_sleeper
+  {
+    int64_t wake_at;            /* Absolute wake-up tick. */
+    struct semaphore *done;     /* Upped after waking. */
+  };
+
+static void sleeper (void *);
+static void report (const char *phase, int64_t cnt0, uint64_t cyc0);
+
+void
+test_alarm_bench (void)
+{
+  struct bench_sleeper *sleepers;
+  struct semaphore done;
+  int64_t start, cnt;
+  uint64_t cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sleepers = malloc (sizeof *sleepers * SLEEPER_CNT);
+  if (sleepers == NULL)
+    PANIC ("couldn't allocate memory for test");
+  sema_init (&done, 0);
+
+  msg ("Creating %d sleepers, waking %d per tick.",
+       SLEEPER_CNT, SLEEPERS_PER_TICK);
+  start = timer_ticks ();
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      char name[16];
+
+      sleepers[i].wake_at = start + WAKE_DELAY + i / SLEEPERS_PER_TICK;
+      sleepers[i].done = &done;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, &sleepers[i])
+          == TID_ERROR)
+        fail ("thread_create failed for sleeper %d", i);
+    }
+
+  /* Let every sleeper block, then measure ticks on which no
+     sleeper is due. */
+  timer_sleep (WAKE_DELAY / 2 - (timer_ticks () - start));
+  timer_intr_stats (&cnt, &cycles);
+  timer_sleep (start + WAKE_DELAY - 1 - timer_ticks ());
+  report ("idle ticks", cnt, cycles);
+
+  /* Measure the ticks on which sleepers wake up. */
+  timer_intr_stats (&cnt, &cycles);
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&done);
+  report ("wake-up ticks", cnt, cycles);
+
+  free (sleepers);
+  pass ();
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *s_)
+{
+  struct bench_sleeper *s = s_;
+
+  timer_sleep (s->wake_at - timer_ticks ());
+  sema_up (s->done);
+}
+
+/* Prints the average handler cycles per tick since the snapshot
+   CNT0, CYC0 taken with timer_intr_stats(). */
+static void
+report (const char *phase, int64_t cnt0, uint64_t cyc0)
+{
+  int64_t cnt;
+  uint64_t cycles;
+
+  timer_intr_stats (&cnt, &cycles);
+  if (cnt == cnt0)
+    msg ("%s: no timer interrupts", phase);
+  else
+    msg ("%s: %"PRId64" ticks, %"PRIu64" cycles/tick", phase,
+         cnt - cnt0, (cycles - cyc0) / (uint64_t) (cnt - cnt0));
+}
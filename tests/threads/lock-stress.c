@@ -0,0 +1,118 @@
+/* Has 200 threads of mixed priorities block on one lock, then
+   lets them through one at a time.  Checks that each release
+   hands the lock to the highest-priority waiter, oldest first
+   among equals, and reports how many TSC cycles pass between a
+   release and the next holder running. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* Number of contending threads. */
+#define THREAD_CNT 200
+
+/* Contenders get priorities PRI_DEFAULT + 1 through
+   PRI_DEFAULT + PRI_SPREAD, spread evenly. */
+#define PRI_SPREAD 32
+
+struct stress
+  {
+    struct lock lock;           /* Contended lock. */
+    struct semaphore done;      /* Upped by each contender. */
+    uint64_t released_at;       /* TSC when the lock was last released. */
+    uint64_t total_cycles;      /* Sum of wake-up latencies. */
+    uint64_t max_cycles;        /* Largest wake-up latency. */
+    int order[THREAD_CNT];      /* Contender ids, in acquisition order. */
+    int acquired;               /* # of entries in `order'. */
+  };
+
+struct contender
+  {
+    struct stress *s;
+    int id;                     /* Creation order. */
+    int priority;
+  };
+
+static void contender_thread (void *);
+
+void
+test_lock_stress (void)
+{
+  static struct stress s;
+  static struct contender contenders[THREAD_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&s.lock);
+  sema_init (&s.done, 0);
+  s.total_cycles = s.max_cycles = 0;
+  s.acquired = 0;
+
+  /* Donation soon raises our priority above some contenders, so
+     not every one of them preempts us when created.  Sleeping
+     afterward lets the rest run and block on the lock too. */
+  lock_acquire (&s.lock);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct contender *c = &contenders[i];
+      char name[16];
+
+      c->s = &s;
+      c->id = i;
+      c->priority = PRI_DEFAULT + 1 + (i * 7) % PRI_SPREAD;
+      snprintf (name, sizeof name, "contender %d", i);
+      if (thread_create (name, c->priority, contender_thread, c)
+          == TID_ERROR)
+        fail ("thread_create failed for contender %d", i);
+    }
+  timer_sleep (10);
+  msg ("%d threads waiting.", THREAD_CNT);
+
+  s.released_at = rdtsc ();
+  lock_release (&s.lock);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&s.done);
+
+  for (i = 1; i < THREAD_CNT; i++)
+    {
+      struct contender *a = &contenders[s.order[i - 1]];
+      struct contender *b = &contenders[s.order[i]];
+      if (a->priority < b->priority
+          || (a->priority == b->priority && a->id > b->id))
+        fail ("contender %d (priority %d) acquired the lock before "
+              "contender %d (priority %d)",
+              a->id, a->priority, b->id, b->priority);
+    }
+  msg ("Lock handed over in priority order.");
+  msg ("wake-up latency: %"PRIu64" cycles average, %"PRIu64" max",
+       s.total_cycles / THREAD_CNT, s.max_cycles);
+  pass ();
+}
+
+static void
+contender_thread (void *c_)
+{
+  struct contender *c = c_;
+  struct stress *s = c->s;
+  uint64_t latency;
+
+  lock_acquire (&s->lock);
+  latency = rdtsc () - s->released_at;
+  s->total_cycles += latency;
+  if (latency > s->max_cycles)
+    s->max_cycles = latency;
+  s->order[s->acquired++] = c->id;
+  s->released_at = rdtsc ();
+  lock_release (&s->lock);
+  sema_up (&s->done);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# Latencies vary from run to run.
+s/\d+ cycles average, \d+ max$/N cycles average, N max/ foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(lock-stress) begin
+(lock-stress) 200 threads waiting.
+(lock-stress) Lock handed over in priority order.
+(lock-stress) wake-up latency: N cycles average, N max
+(lock-stress) PASS
+(lock-stress) end
+EOF
+pass;
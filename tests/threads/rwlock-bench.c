@@ -0,0 +1,140 @@
+/* Runs READER_CNT reader threads against one writer thread on a
+   shared table for RUN_TICKS timer ticks, first protecting the
+   table with a readers-writer lock and then with a plain lock,
+   and reports the number of reads and writes completed under
+   each. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of reader threads. */
+#define READER_CNT 8
+
+/* Length of each run, in timer ticks. */
+#define RUN_TICKS 200
+
+/* Entries in the shared table. */
+#define TABLE_SIZE 64
+
+struct bench
+  {
+    bool use_rwlock;            /* Readers-writer or plain lock? */
+    struct rwlock rwlock;
+    struct lock lock;
+    int table[TABLE_SIZE];      /* Shared data. */
+    int64_t end;                /* Tick at which threads stop. */
+    int64_t reads;              /* Reads completed. */
+    int64_t writes;             /* Writes completed. */
+    struct semaphore done;      /* Upped by each thread on exit. */
+  };
+
+static void run (struct bench *, bool use_rwlock);
+static void reader (void *);
+static void writer (void *);
+
+void
+test_rwlock_bench (void)
+{
+  static struct bench b;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("%d readers and 1 writer, %d ticks per run.",
+       READER_CNT, RUN_TICKS);
+  run (&b, true);
+  run (&b, false);
+  pass ();
+}
+
+/* Runs the readers and the writer once and reports throughput. */
+static void
+run (struct bench *b, bool use_rwlock)
+{
+  int i;
+
+  b->use_rwlock = use_rwlock;
+  rwlock_init (&b->rwlock);
+  lock_init (&b->lock);
+  b->reads = b->writes = 0;
+  sema_init (&b->done, 0);
+  b->end = timer_ticks () + RUN_TICKS;
+
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader, b);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer, b);
+
+  for (i = 0; i < READER_CNT + 1; i++)
+    sema_down (&b->done);
+
+  msg ("%s: %"PRId64" reads/s, %"PRId64" writes/s",
+       use_rwlock ? "rwlock" : "lock",
+       b->reads * TIMER_FREQ / RUN_TICKS, b->writes * TIMER_FREQ / RUN_TICKS);
+}
+
+/* Reader thread: sums the table until time runs out. */
+static void
+reader (void *b_)
+{
+  struct bench *b = b_;
+  int64_t reads = 0;
+  volatile int sum;
+
+  while (timer_ticks () < b->end)
+    {
+      int i;
+
+      if (b->use_rwlock)
+        rwlock_acquire_read (&b->rwlock);
+      else
+        lock_acquire (&b->lock);
+      for (sum = i = 0; i < TABLE_SIZE; i++)
+        sum += b->table[i];
+      if (b->use_rwlock)
+        rwlock_release_read (&b->rwlock);
+      else
+        lock_release (&b->lock);
+      reads++;
+    }
+
+  lock_acquire (&b->lock);
+  b->reads += reads;
+  lock_release (&b->lock);
+  sema_up (&b->done);
+}
+
+/* Writer thread: updates the table once per tick until time runs
+   out. */
+static void
+writer (void *b_)
+{
+  struct bench *b = b_;
+
+  while (timer_ticks () < b->end)
+    {
+      int i;
+
+      if (b->use_rwlock)
+        rwlock_acquire_write (&b->rwlock);
+      else
+        lock_acquire (&b->lock);
+      for (i = 0; i < TABLE_SIZE; i++)
+        b->table[i]++;
+      if (b->use_rwlock)
+        rwlock_release_write (&b->rwlock);
+      else
+        lock_release (&b->lock);
+      b->writes++;
+      timer_sleep (1);
+    }
+  sema_up (&b->done);
+}
@@ -0,0 +1,194 @@
+/* Exercises the real-time scheduling classes under a load of
+   CPU-bound PRI_MAX threads.  Measures how late a thread that
+   sleeps one tick at a time wakes up, first as a SCHED_NORMAL
+   thread at PRI_MAX, then as a SCHED_FIFO thread, which should
+   never be late.  Then checks that a SCHED_DEADLINE thread that
+   never blocks runs for only its budget in each period, and that
+   admission control refuses to overcommit the CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of CPU-bound threads. */
+#define BATCH_CNT 4
+
+/* Number of one-tick sleeps the probe makes. */
+#define PROBE_CNT 50
+
+/* SCHED_DEADLINE parameters of the budget test, and how many
+   ticks it lasts. */
+#define DL_RUNTIME 2
+#define DL_PERIOD 10
+#define DL_SPAN 100
+
+struct load
+  {
+    volatile bool stop;         /* Tells the threads to finish. */
+    struct semaphore done;      /* Upped by each thread as it ends. */
+  };
+
+struct probe
+  {
+    struct semaphore done;      /* Upped when the probe is done. */
+    bool fifo;                  /* Switch to SCHED_FIFO first? */
+    int64_t total_late;         /* Sum of ticks late. */
+    int64_t max_late;           /* Most ticks late. */
+  };
+
+struct budget
+  {
+    struct load *load;
+    struct semaphore ready;     /* Upped once in SCHED_DEADLINE. */
+    long long ran;              /* Ticks run while in it. */
+  };
+
+static void spin_thread (void *);
+static void probe_thread (void *);
+static void budget_thread (void *);
+static void run_probe (bool fifo);
+
+void
+test_sched_rt (void)
+{
+  struct sched_attr fifo = { .sched_class = SCHED_FIFO,
+                             .priority = SCHED_FIFO_PRI_MAX - 1 };
+  struct sched_attr normal = { .sched_class = SCHED_NORMAL };
+  struct sched_attr dl = { .sched_class = SCHED_DEADLINE };
+  static struct load load;
+  static struct budget budget;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* We have to run ahead of the load we create, to stop it. */
+  if (!thread_set_sched (&fifo))
+    fail ("could not switch to SCHED_FIFO");
+
+  dl.runtime = 20;
+  dl.period = 20;
+  if (cpu_cnt == 1 && thread_set_sched (&dl))
+    fail ("admitted a SCHED_DEADLINE thread using all of the CPU");
+
+  run_probe (false);
+  run_probe (true);
+
+  /* A SCHED_DEADLINE thread that never blocks, competing with a
+     CPU-bound thread. */
+  load.stop = false;
+  sema_init (&load.done, 0);
+  budget.load = &load;
+  sema_init (&budget.ready, 0);
+  thread_create ("spin", PRI_MAX, spin_thread, &load);
+  thread_create ("budget", PRI_DEFAULT, budget_thread, &budget);
+  sema_down (&budget.ready);
+
+  dl.runtime = DL_PERIOD - DL_RUNTIME;
+  dl.period = DL_PERIOD;
+  if (cpu_cnt == 1 && thread_set_sched (&dl))
+    fail ("admitted SCHED_DEADLINE bandwidth beyond the CPU");
+
+  timer_sleep (DL_SPAN);
+  load.stop = true;
+  for (i = 0; i < 2; i++)
+    sema_down (&load.done);
+  msg ("SCHED_DEADLINE %d/%d ran %lld of %d ticks.",
+       DL_RUNTIME, DL_PERIOD, budget.ran, DL_SPAN);
+  if (budget.ran > DL_RUNTIME * (DL_SPAN / DL_PERIOD + 1))
+    fail ("SCHED_DEADLINE thread overran its budget");
+  if (budget.ran < DL_RUNTIME * (DL_SPAN / DL_PERIOD - 1))
+    fail ("SCHED_DEADLINE thread did not get its budget");
+
+  thread_set_sched (&normal);
+  pass ();
+}
+
+/* Runs a probe, as a SCHED_FIFO thread if FIFO is true, while
+   BATCH_CNT threads hog the CPU, and reports how late it woke. */
+static void
+run_probe (bool fifo)
+{
+  static struct load load;
+  static struct probe probe;
+  int i;
+
+  load.stop = false;
+  sema_init (&load.done, 0);
+  for (i = 0; i < BATCH_CNT; i++)
+    thread_create ("spin", PRI_MAX, spin_thread, &load);
+
+  sema_init (&probe.done, 0);
+  probe.fifo = fifo;
+  probe.total_late = probe.max_late = 0;
+  thread_create ("probe", PRI_MAX, probe_thread, &probe);
+  sema_down (&probe.done);
+
+  load.stop = true;
+  for (i = 0; i < BATCH_CNT; i++)
+    sema_down (&load.done);
+
+  msg ("%s probe: %lld ticks late in %d wake-ups, at most %lld.",
+       fifo ? "SCHED_FIFO" : "PRI_MAX", probe.total_late, PROBE_CNT,
+       probe.max_late);
+  if (fifo && probe.max_late != 0)
+    fail ("SCHED_FIFO probe woke up late");
+}
+
+static void
+spin_thread (void *load_)
+{
+  struct load *load = load_;
+
+  while (!load->stop)
+    continue;
+  sema_up (&load->done);
+}
+
+static void
+probe_thread (void *probe_)
+{
+  struct probe *probe = probe_;
+  struct sched_attr fifo = { .sched_class = SCHED_FIFO,
+                             .priority = SCHED_FIFO_PRI_MIN };
+  int i;
+
+  if (probe->fifo && !thread_set_sched (&fifo))
+    fail ("could not switch probe to SCHED_FIFO");
+
+  for (i = 0; i < PROBE_CNT; i++)
+    {
+      int64_t wakeup = timer_ticks () + 1;
+      int64_t late;
+
+      timer_sleep (1);
+      late = timer_ticks () - wakeup;
+      probe->total_late += late;
+      if (late > probe->max_late)
+        probe->max_late = late;
+    }
+  sema_up (&probe->done);
+}
+
+static void
+budget_thread (void *budget_)
+{
+  struct budget *budget = budget_;
+  struct sched_attr dl = { .sched_class = SCHED_DEADLINE,
+                           .runtime = DL_RUNTIME, .period = DL_PERIOD };
+  long long start;
+
+  if (!thread_set_sched (&dl))
+    fail ("SCHED_DEADLINE %d/%d refused", DL_RUNTIME, DL_PERIOD);
+  start = thread_current ()->stats.kernel_ticks;
+  sema_up (&budget->ready);
+
+  while (!budget->load->stop)
+    continue;
+  budget->ran = thread_current ()->stats.kernel_ticks - start;
+  sema_up (&budget->load->done);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# How late the PRI_MAX probe wakes and how long the SCHED_DEADLINE
+# thread runs vary from run to run.  The test checks the latter's
+# bounds by itself.
+foreach (@output) {
+    s/PRI_MAX probe: \d+ ticks late in (\d+) wake-ups, at most \d+\.$/PRI_MAX probe: N ticks late in $1 wake-ups, at most N./;
+    s/ran \d+ of (\d+) ticks\.$/ran N of $1 ticks./;
+}
+
+compare_output ("run", \@output, [<<'EOF']);
+(sched-rt) begin
+(sched-rt) PRI_MAX probe: N ticks late in 50 wake-ups, at most N.
+(sched-rt) SCHED_FIFO probe: 0 ticks late in 50 wake-ups, at most 0.
+(sched-rt) SCHED_DEADLINE 2/10 ran N of 100 ticks.
+(sched-rt) PASS
+(sched-rt) end
+EOF
+pass;
@@ -0,0 +1,94 @@
+/* Runs two threads that hand control back and forth through a
+   pair of semaphores ROUND_CNT times, so that every handoff
+   blocks one thread and wakes the other, and reports the number
+   of context switches per second and TSC cycles per switch. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* Number of round trips between the two threads. */
+#define ROUND_CNT 100000
+
+struct bench
+  {
+    struct semaphore ping;      /* Upped to run the ping thread. */
+    struct semaphore pong;      /* Upped to run the pong thread. */
+    struct semaphore done;      /* Upped by each thread on exit. */
+  };
+
+static void ping (void *);
+static void pong (void *);
+
+void
+test_switch_bench (void)
+{
+  static struct bench b;
+  int64_t start_ticks, ticks;
+  uint64_t start_tsc, cycles;
+  int64_t switches = 2 * (int64_t) ROUND_CNT;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&b.ping, 0);
+  sema_init (&b.pong, 0);
+  sema_init (&b.done, 0);
+
+  msg ("%d round trips between 2 threads.", ROUND_CNT);
+  thread_create ("ping", PRI_DEFAULT, ping, &b);
+  thread_create ("pong", PRI_DEFAULT, pong, &b);
+
+  start_ticks = timer_ticks ();
+  start_tsc = rdtsc ();
+  sema_up (&b.ping);
+  sema_down (&b.done);
+  sema_down (&b.done);
+  cycles = rdtsc () - start_tsc;
+  ticks = timer_elapsed (start_ticks);
+
+  if (ticks > 0)
+    msg ("%"PRId64" switches/s", switches * TIMER_FREQ / ticks);
+  else
+    msg ("finished in under one tick");
+  msg ("%"PRIu64" cycles per switch", cycles / switches);
+  pass ();
+}
+
+/* Starts each round trip and waits for it to come back. */
+static void
+ping (void *b_)
+{
+  struct bench *b = b_;
+  int i;
+
+  sema_down (&b->ping);
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_up (&b->pong);
+      sema_down (&b->ping);
+    }
+  sema_up (&b->pong);
+  sema_up (&b->done);
+}
+
+/* Sends each round trip back. */
+static void
+pong (void *b_)
+{
+  struct bench *b = b_;
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_down (&b->pong);
+      sema_up (&b->ping);
+    }
+  sema_down (&b->pong);
+  sema_up (&b->done);
+}
@@ -17,6 +17,11 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-bench", test_alarm_bench},
+    {"rwlock-bench", test_rwlock_bench},
+    {"lock-stress", test_lock_stress},
+    {"switch-bench", test_switch_bench},
+    {"sched-rt", test_sched_rt},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
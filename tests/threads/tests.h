@@ -11,6 +11,11 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_bench;
+extern test_func test_rwlock_bench;
+extern test_func test_lock_stress;
+extern test_func test_switch_bench;
+extern test_func test_sched_rt;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
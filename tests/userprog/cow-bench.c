@@ -0,0 +1,73 @@
+/* Measures how long fork() takes in a parent with 1 MiB, 16 MiB
+   and 64 MiB of memory it has written to.  With copy-on-write
+   fork(), the child shares the parent's pages instead of getting
+   copies, so the time should grow with the page tables, much more
+   slowly than with the memory.  Each child exits at once; each
+   fork is timed in TSC cycles up to its return in the parent.
+
+   The arena lives in BSS, so a kernel without VM loads all of it
+   up front, and needs -m 256 to fit it. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define ARENA_SIZE (64 * ONE_MB)
+#define ROUNDS 5
+
+static char arena[ARENA_SIZE];
+
+static uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Writes to every page of the first SIZE bytes of the arena, then
+   forks ROUNDS times, and reports the fastest and mean fork(). */
+static void
+bench (size_t size)
+{
+  uint64_t best = UINT64_MAX, total = 0;
+  size_t i;
+  int round;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      uint64_t start, cycles;
+      pid_t pid;
+
+      for (i = 0; i < size; i += PAGE_SIZE)
+        arena[i] = (char) (i / PAGE_SIZE + round);
+
+      start = rdtsc ();
+      pid = fork ("child");
+      if (pid == 0)
+        exit (arena[size - PAGE_SIZE] == (char) (size / PAGE_SIZE - 1 + round)
+              ? 0 : 1);
+      cycles = rdtsc () - start;
+      if (pid < 0)
+        fail ("fork() with %zu MiB returned %d", size / ONE_MB, pid);
+      if (wait (pid) != 0)
+        fail ("child with %zu MiB saw the wrong data", size / ONE_MB);
+
+      total += cycles;
+      if (cycles < best)
+        best = cycles;
+    }
+  msg ("%2zu MiB: fork() best %llu, mean %llu cycles", size / ONE_MB,
+       (unsigned long long) best, (unsigned long long) (total / ROUNDS));
+}
+
+void
+test_main (void)
+{
+  bench (1 * ONE_MB);
+  bench (16 * ONE_MB);
+  bench (64 * ONE_MB);
+}
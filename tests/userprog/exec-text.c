@@ -0,0 +1,42 @@
+/* Launches COPIES copies of this program, one after another, and
+   reports how many disk sectors the file system read to do so.
+   Each copy loads its pages on demand, and the read-only pages of
+   its text come from the copy that the executable's inode keeps
+   for all processes running it, so after the first launch only
+   the ELF headers and the writable pages should need reading. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define COPIES 50
+
+int
+main (int argc, char *argv[])
+{
+  long long start, first;
+  int i;
+
+  if (argc > 1)
+    return 0;
+
+  test_name = argv[0];
+  msg ("begin");
+  start = get_fs_disk_read_cnt ();
+  for (i = 0; i < COPIES; i++)
+    {
+      pid_t pid = fork ("exec-text");
+      if (pid == 0)
+        exec ("exec-text child");
+      if (pid < 0)
+        fail ("fork() #%d returned %d", i, pid);
+      if (wait (pid) != 0)
+        fail ("copy #%d failed", i);
+      if (i == 0)
+        first = get_fs_disk_read_cnt () - start;
+    }
+  msg ("first copy: %lld sectors read", first);
+  msg ("%d copies: %lld sectors read", COPIES,
+       get_fs_disk_read_cnt () - start);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,91 @@
+/* Fork-exec-wait microbenchmark.  Forks ITERATIONS children, one
+   at a time, each of which executes this program again with an
+   argument that makes it exit at once, and waits for each, then
+   reports forks per second.
+
+   User programs have no clock, so the TSC is timed against the
+   timer ticks charged to this thread while it spins.  Compare
+   the rate with the thread page cache off (kernel option -tc=0)
+   and on, and see the kernel's "Thread cache:" line at power-off
+   for its hits and misses. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define ITERATIONS 200
+
+/* Timer ticks per second: TIMER_FREQ in devices/timer.h. */
+#define TICKS_PER_SEC 100
+
+/* Timer ticks to calibrate the TSC over. */
+#define CALIBRATE_TICKS 20
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Returns the number of timer ticks charged to this thread. */
+static long long
+ticks (void)
+{
+  struct thread_stats s;
+
+  get_thread_stats (&s);
+  return s.user_ticks + s.kernel_ticks;
+}
+
+/* Returns the number of TSC cycles per second.  Nothing else
+   runs meanwhile, so every tick is charged to this thread. */
+static uint64_t
+tsc_per_sec (void)
+{
+  long long start = ticks ();
+  uint64_t t0;
+
+  /* Start on a tick boundary. */
+  while (ticks () == start)
+    continue;
+  t0 = rdtsc ();
+  start++;
+  while (ticks () < start + CALIBRATE_TICKS)
+    continue;
+  return (rdtsc () - t0) * TICKS_PER_SEC / CALIBRATE_TICKS;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t hz, start, cycles;
+  int i;
+
+  if (argc > 1)
+    return 0;
+
+  test_name = argv[0];
+  msg ("begin");
+  hz = tsc_per_sec ();
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t pid = fork ("fork-bench");
+      if (pid == 0)
+        exec ("fork-bench child");
+      if (pid < 0)
+        fail ("fork() #%d returned %d", i, pid);
+      if (wait (pid) != 0)
+        fail ("wait() for child #%d failed", i);
+    }
+  cycles = rdtsc () - start;
+  msg ("%d fork-exec-wait cycles, %llu TSC cycles each",
+       ITERATIONS, (unsigned long long) (cycles / ITERATIONS));
+  msg ("%llu forks/sec",
+       (unsigned long long) (ITERATIONS * hz / (cycles ? cycles : 1)));
+  msg ("end");
+  return 0;
+}
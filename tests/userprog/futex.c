@@ -0,0 +1,96 @@
+/* Exercises the futex system calls and the user mutex built on
+   them: first without blocking, waiting on a word that no longer
+   holds the expected value, waking with nobody waiting, a
+   misaligned word, and mutex lock, trylock and unlock; then with
+   threads made by uthread_create(), one that sleeps in futex_wait()
+   until woken, and several that contend for a mutex. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static unsigned words[2];
+
+/* Word the waiter thread sleeps on, and whether it got that far. */
+static unsigned word;
+static volatile int ready;
+
+/* Counter the incrementer threads share under COUNTER_LOCK. */
+#define INCREMENTERS 3
+#define INCREMENTS 1000
+static struct mutex counter_lock = MUTEX_INITIALIZER;
+static volatile int counter;
+
+/* Sleeps on WORD, and returns futex_wait()'s result. */
+static int
+waiter (void *aux UNUSED)
+{
+  ready = 1;
+  return futex_wait (&word, 0);
+}
+
+/* Adds INCREMENTS to COUNTER, one at a time, slowly enough that
+   the threads doing it collide on COUNTER_LOCK. */
+static int
+incrementer (void *aux UNUSED)
+{
+  int i, j;
+
+  for (i = 0; i < INCREMENTS; i++)
+    {
+      int c;
+
+      mutex_lock (&counter_lock);
+      c = counter;
+      for (j = 0; j < 100; j++)
+        asm volatile ("" ::: "memory");
+      counter = c + 1;
+      mutex_unlock (&counter_lock);
+    }
+  return 0;
+}
+
+void
+test_main (void)
+{
+  struct mutex m = MUTEX_INITIALIZER;
+  struct condvar cv = CONDVAR_INITIALIZER;
+  int tids[INCREMENTERS];
+  int tid, i;
+
+  words[0] = 1;
+  CHECK (futex_wait (&words[0], 0) == -1,
+         "futex_wait on changed word returns at once");
+  CHECK (futex_wake (&words[0], 1) == 0, "futex_wake with no waiters");
+  CHECK (futex_wait ((unsigned *) ((char *) words + 1), 0) == -1,
+         "futex_wait on misaligned word fails");
+
+  mutex_lock (&m);
+  CHECK (m.state == 1, "uncontended lock leaves no waiters mark");
+  CHECK (!mutex_trylock (&m), "trylock of locked mutex fails");
+  cond_signal (&cv);
+  cond_broadcast (&cv);
+  mutex_unlock (&m);
+  CHECK (mutex_trylock (&m), "trylock of unlocked mutex succeeds");
+  mutex_unlock (&m);
+  CHECK (m.state == 0, "unlock frees mutex");
+
+  /* WORD stays 0 until a wake finds the waiter asleep, so that it
+     cannot miss the wake-up by checking WORD too late. */
+  CHECK ((tid = uthread_create (waiter, NULL)) != -1, "create waiter");
+  while (!ready)
+    continue;
+  while (futex_wake (&word, 1) == 0)
+    continue;
+  word = 1;
+  CHECK (uthread_join (tid) == 0, "waiter sleeps in futex_wait until woken");
+
+  for (i = 0; i < INCREMENTERS; i++)
+    CHECK ((tids[i] = uthread_create (incrementer, NULL)) != -1,
+           "create incrementer %d", i);
+  for (i = 0; i < INCREMENTERS; i++)
+    CHECK (uthread_join (tids[i]) == 0, "join incrementer %d", i);
+  CHECK (counter == INCREMENTERS * INCREMENTS,
+         "contended mutex counts %d increments", counter);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex) begin
+(futex) futex_wait on changed word returns at once
+(futex) futex_wake with no waiters
+(futex) futex_wait on misaligned word fails
+(futex) uncontended lock leaves no waiters mark
+(futex) trylock of locked mutex fails
+(futex) trylock of unlocked mutex succeeds
+(futex) unlock frees mutex
+(futex) create waiter
+(futex) waiter sleeps in futex_wait until woken
+(futex) create incrementer 0
+(futex) create incrementer 1
+(futex) create incrementer 2
+(futex) join incrementer 0
+(futex) join incrementer 1
+(futex) join incrementer 2
+(futex) contended mutex counts 3000 increments
+(futex) end
+futex: exit(0)
+EOF
+pass;
@@ -0,0 +1,68 @@
+/* Checks the stack limit that set_stack_limit() sets.  A child
+   that puts a 512 kB array on its stack runs within the default
+   1 MB limit; after the limit drops to 64 kB, a child that
+   recurses through 128 kB of stack runs into the guard page and
+   is killed.  Also checks that out-of-range limits are refused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Touches every page of a 512 kB array on the stack and returns
+   the number of pages. */
+static int
+big_frame (void)
+{
+  volatile char buf[512 * 1024];
+  int sum = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof buf; i += 4096)
+    buf[i] = 1;
+  for (i = 0; i < sizeof buf; i += 4096)
+    sum += buf[i];
+  return sum;
+}
+
+/* Uses about 4 kB of stack per level, DEPTH levels deep. */
+static int
+recurse (int depth)
+{
+  volatile char buf[4000];
+
+  buf[0] = depth;
+  return depth == 0 ? 0 : recurse (depth - 1) + buf[0] - depth;
+}
+
+static int
+run_child (const char *name, int (*func) (void))
+{
+  pid_t pid = fork (name);
+
+  if (pid < 0)
+    fail ("fork \"%s\" failed", name);
+  if (pid == 0)
+    exit (func ());
+  return wait (pid);
+}
+
+static int
+deep (void)
+{
+  return recurse (32);
+}
+
+void
+test_main (void)
+{
+  CHECK (set_stack_limit (0) == -1, "set_stack_limit (0) refused");
+  CHECK (set_stack_limit (64 * 1024 * 1024) == -1,
+         "set_stack_limit (64 MB) refused");
+
+  CHECK (run_child ("big", big_frame) == 128,
+         "512 kB stack frame fits the default limit");
+
+  CHECK (set_stack_limit (64 * 1024) == 0, "set_stack_limit (64 kB)");
+  CHECK (run_child ("deep", deep) == -1,
+         "128 kB of stack overflows a 64 kB limit");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(stack-limit) begin
+(stack-limit) set_stack_limit (0) refused
+(stack-limit) set_stack_limit (64 MB) refused
+(stack-limit) 512 kB stack frame fits the default limit
+big: exit(128)
+(stack-limit) set_stack_limit (64 kB)
+(stack-limit) 128 kB of stack overflows a 64 kB limit
+deep: exit(-1)
+(stack-limit) end
+stack-limit: exit(0)
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Reads this process's scheduler statistics through the
+   thread_stats system call, after waiting for a child (which
+   blocks us) and spinning in user mode until a timer tick lands
+   there.  Checks that the counters moved and prints them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+int
+main (int argc, char *argv[])
+{
+  struct thread_stats s;
+  pid_t pid;
+  int i;
+
+  if (argc > 1)
+    return 0;
+
+  test_name = argv[0];
+  msg ("begin");
+
+  pid = fork ("thread-stats");
+  if (pid == 0)
+    exec ("thread-stats child");
+  if (pid < 0)
+    fail ("fork() returned %d", pid);
+  if (wait (pid) != 0)
+    fail ("wait() for child failed");
+
+  do
+    get_thread_stats (&s);
+  while (s.user_ticks == 0);
+
+  if (s.voluntary_switches == 0)
+    fail ("no voluntary switches after wait()");
+  for (i = 0; i < THREAD_WAIT_BUCKETS; i++)
+    if (s.wait_hist[i] != 0)
+      break;
+  if (i == THREAD_WAIT_BUCKETS)
+    fail ("empty ready wait histogram");
+
+  msg ("%lld user ticks, %lld kernel ticks", s.user_ticks, s.kernel_ticks);
+  msg ("%lld voluntary, %lld involuntary switches",
+       s.voluntary_switches, s.involuntary_switches);
+  for (i = 0; i < THREAD_WAIT_BUCKETS; i++)
+    if (s.wait_hist[i] != 0)
+      msg ("ready wait 2^%d cycles: %lld", i, s.wait_hist[i]);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The counts vary from run to run, and so does which histogram
+# buckets are filled.  The program fails by itself if they stay 0.
+@output = grep (!/^\(thread-stats\) ready wait 2\^\d+ cycles: \d+$/,
+		@output);
+foreach (@output) {
+    s/\d+ user ticks, \d+ kernel ticks$/N user ticks, N kernel ticks/;
+    s/\d+ voluntary, \d+ involuntary switches$/N voluntary, N involuntary switches/;
+}
+
+compare_output ("run", \@output, [<<'EOF']);
+(thread-stats) begin
+thread-stats: exit(0)
+(thread-stats) N user ticks, N kernel ticks
+(thread-stats) N voluntary, N involuntary switches
+(thread-stats) end
+thread-stats: exit(0)
+EOF
+pass;
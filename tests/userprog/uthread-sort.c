@@ -0,0 +1,170 @@
+/* Sorts an array in WORKERS chunks in parallel, then merges the
+   chunks, twice: once with threads made by uthread_create(),
+   which sort their chunks in place in the shared address space,
+   and once with fork()ed children, which each sort a copy of the
+   array and hand their chunk back through a file.  Checks both
+   results and reports the TSC cycles each way took, so the cost
+   of copying the address space for every worker shows. */
+
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define WORKERS 4
+#define CHUNK 2048
+#define SIZE (WORKERS * CHUNK)
+
+static int data[SIZE];
+static int merged[SIZE];
+
+static uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+static void
+fill (void)
+{
+  size_t i;
+
+  random_init (0);
+  for (i = 0; i < SIZE; i++)
+    data[i] = random_ulong () % 100000;
+}
+
+/* Shell sort: no recursion, so it fits any stack. */
+static void
+sort (int *a, size_t cnt)
+{
+  size_t gap, i, j;
+
+  for (gap = cnt / 2; gap > 0; gap /= 2)
+    for (i = gap; i < cnt; i++)
+      {
+        int x = a[i];
+        for (j = i; j >= gap && a[j - gap] > x; j -= gap)
+          a[j] = a[j - gap];
+        a[j] = x;
+      }
+}
+
+/* Merges the WORKERS sorted chunks of DATA into MERGED and
+   checks that the result is sorted. */
+static void
+merge_and_check (const char *how)
+{
+  size_t pos[WORKERS];
+  size_t i, w;
+
+  memset (pos, 0, sizeof pos);
+  for (i = 0; i < SIZE; i++)
+    {
+      int best = -1;
+      for (w = 0; w < WORKERS; w++)
+        if (pos[w] < CHUNK
+            && (best < 0 || data[w * CHUNK + pos[w]]
+                            < data[best * CHUNK + pos[best]]))
+          best = w;
+      merged[i] = data[best * CHUNK + pos[best]++];
+    }
+  for (i = 1; i < SIZE; i++)
+    if (merged[i - 1] > merged[i])
+      fail ("%s: merged[%zu] = %d > merged[%zu] = %d",
+            how, i - 1, merged[i - 1], i, merged[i]);
+}
+
+static int
+sort_chunk (void *w_)
+{
+  int w = (intptr_t) w_;
+  sort (data + w * CHUNK, CHUNK);
+  return w;
+}
+
+static uint64_t
+with_threads (void)
+{
+  int tids[WORKERS];
+  uint64_t start = rdtsc ();
+  int w;
+
+  for (w = 0; w < WORKERS; w++)
+    {
+      tids[w] = uthread_create (sort_chunk, (void *) (intptr_t) w);
+      if (tids[w] < 0)
+        fail ("uthread_create() #%d returned %d", w, tids[w]);
+    }
+  for (w = 0; w < WORKERS; w++)
+    if (uthread_join (tids[w]) != w)
+      fail ("uthread_join() of thread #%d returned wrong status", w);
+  merge_and_check ("threads");
+  return rdtsc () - start;
+}
+
+static uint64_t
+with_processes (void)
+{
+  pid_t pids[WORKERS];
+  char name[16];
+  uint64_t start = rdtsc ();
+  int w;
+
+  for (w = 0; w < WORKERS; w++)
+    {
+      snprintf (name, sizeof name, "chunk%d", w);
+      if (!create (name, CHUNK * sizeof *data))
+        fail ("create \"%s\"", name);
+      pids[w] = fork ("worker");
+      if (pids[w] < 0)
+        fail ("fork() #%d returned %d", w, pids[w]);
+      if (pids[w] == 0)
+        {
+          int fd = open (name);
+          sort_chunk ((void *) (intptr_t) w);
+          if (fd < 0 || write (fd, data + w * CHUNK, CHUNK * sizeof *data)
+                        != (int) (CHUNK * sizeof *data))
+            exit (-1);
+          exit (w);
+        }
+    }
+  for (w = 0; w < WORKERS; w++)
+    {
+      int fd;
+
+      if (wait (pids[w]) != w)
+        fail ("worker #%d failed", w);
+      snprintf (name, sizeof name, "chunk%d", w);
+      fd = open (name);
+      if (fd < 0 || read (fd, data + w * CHUNK, CHUNK * sizeof *data)
+                    != (int) (CHUNK * sizeof *data))
+        fail ("read back \"%s\"", name);
+      close (fd);
+      remove (name);
+    }
+  merge_and_check ("processes");
+  return rdtsc () - start;
+}
+
+void
+test_main (void)
+{
+  uint64_t threads, processes;
+
+  fill ();
+  threads = with_threads ();
+  msg ("%d threads sorted %d ints", WORKERS, SIZE);
+
+  fill ();
+  processes = with_processes ();
+  msg ("%d processes sorted %d ints", WORKERS, SIZE);
+
+  msg ("threads: %llu cycles, processes: %llu cycles",
+       (unsigned long long) threads, (unsigned long long) processes);
+}
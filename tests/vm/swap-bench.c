@@ -0,0 +1,45 @@
+/* Measures swap throughput.  With 10 MB of memory, writes every
+   byte of a 20 MB array, so that most of it has to be swapped
+   out, then reads it all back and checks it, twice over, so that
+   pages stream both ways through the swap disk.
+
+   The kernel counts the pages it swaps and the time the disk
+   transfers take, and prints the rates in MB/s in its "Swap:"
+   lines at power-off.  The swap disk must hold the whole array:
+   run with -m 10 and --swap-disk=30. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (20 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASSES 2
+
+static char big_chunks[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  size_t i, pass;
+
+  for (pass = 0; pass < PASSES; pass++)
+    {
+      for (i = 0; i < PAGE_COUNT; i++)
+        memset (big_chunks + i * PAGE_SIZE, (char) (i + pass), PAGE_SIZE);
+      msg ("pass %zu: wrote %d MB", pass, CHUNK_SIZE / ONE_MB);
+
+      for (i = 0; i < PAGE_COUNT; i++)
+        {
+          char *mem = big_chunks + i * PAGE_SIZE;
+          if (mem[0] != (char) (i + pass)
+              || mem[PAGE_SIZE - 1] != (char) (i + pass))
+            fail ("pass %zu: page %zu is inconsistent", pass, i);
+        }
+      msg ("pass %zu: checked %d MB", pass, CHUNK_SIZE / ONE_MB);
+    }
+}
@@ -0,0 +1,48 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Per-CPU state, indexed by `struct cpu' id. */
+struct cpu cpus[CPU_MAX];
+
+/* Number of CPUs online.  Zero until cpu_init() runs. */
+int cpu_cnt;
+
+/* Brings the bootstrap processor online as cpus[0], running
+   INITIAL, the thread that executes init.c:main().  Called by
+   thread_init() once INITIAL is set up.  This is the only CPU
+   brought online; see the comment on struct cpu. */
+void
+cpu_init (struct thread *initial) {
+  struct cpu *c = &cpus[0];
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cpu_cnt == 0);
+
+  c->id = 0;
+  c->curr = initial;
+  initial->cpu = c;
+  list_init (&c->softirqs);
+  spinlock_init (&c->work_lock);
+  list_init (&c->work);
+  sema_init (&c->work_ready, 0);
+  cpu_cnt = 1;
+}
+
+/* Returns the CPU we are running on.
+
+   The running thread is found from the stack pointer, just like
+   running_thread() in thread.c, and records the CPU it was
+   scheduled on.  Interrupts should be off, or the caller may
+   migrate to another CPU before using the result.  Until
+   thread_init() sets up the initial thread, only the bootstrap
+   processor runs. */
+struct cpu *
+this_cpu (void) {
+  if (cpu_cnt == 0)
+    return &cpus[0];
+  return ((struct thread *) pg_round_down (rrsp ()))->cpu;
+}
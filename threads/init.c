@@ -19,8 +19,11 @@
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -95,6 +98,8 @@ main (void) {
 	/* Initialize interrupt handlers. */
 	intr_init ();
 	timer_init ();
+	trace_init ();
+	profile_init ();
 	kbd_init ();
 	input_init ();
 #ifdef USERPROG
@@ -103,6 +108,7 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_init ();
 	serial_init_queue ();
 	timer_calibrate ();
 
@@ -221,6 +227,15 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-tc"))
+			thread_cache_set_max (atoi (value));
+		else if (!strcmp (name, "-trace"))
+			trace_enabled = true;
+		else if (!strcmp (name, "-profile"))
+			profile_mode = (value != NULL && !strcmp (value, "stack")
+			                ? PROFILE_STACK : PROFILE_PC);
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -325,6 +340,10 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -tc=COUNT          Cache at most COUNT freed thread pages (0: none).\n"
+			"  -trace             Record kernel events (see pintos --trace).\n"
+			"  -profile[=stack]   Sample rip (and call stacks) on each tick.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -340,6 +359,8 @@ power_off (void) {
 #ifdef FILESYS
 	filesys_done ();
 #endif
+	trace_dump ();
+	profile_dump ();
 
 	print_stats ();
 
@@ -360,5 +381,9 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	lock_print_stats (&filesys_lock, "filesys_lock");
+#endif
+#ifdef VM
+	swap_print_stats ();
 #endif
 }
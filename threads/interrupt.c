@@ -3,16 +3,19 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/uthread.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -99,9 +102,20 @@ static const char *intr_names[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU tracks whether it is processing an
+   external interrupt, and whether it should yield on return, in
+   its struct cpu.
+
+   Work that a handler defers with intr_defer() runs after the
+   interrupt is acknowledged, with interrupts on, but before the
+   interrupt returns or yields.  An external interrupt may arrive
+   while deferred work runs: it leaves running the deferred work
+   it adds, and yielding, to the pass it interrupted. */
+
+/* Maximum number of deferred work items run on one interrupt
+   return.  The rest go to the CPU's worker thread, so that
+   interrupts that keep deferring work cannot starve threads. */
+#define SOFTIRQ_BUDGET 16
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -109,6 +123,7 @@ static void pic_end_of_interrupt (int irq);
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
+static void run_softirqs (struct cpu *);
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -135,7 +150,8 @@ intr_set_level (enum intr_level level) {
 enum intr_level
 intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
-	ASSERT (!intr_context ());
+	/* Work deferred by intr_defer() may, handlers may not. */
+	ASSERT (!this_cpu ()->in_external_intr);
 
 	/* Enable interrupts by setting the interrupt flag.
 
@@ -252,11 +268,13 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt,
+   including work deferred with intr_defer(), and false at all
+   other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	struct cpu *c = this_cpu ();
+	return c->in_external_intr || c->in_softirq;
 }
 
 /* During processing of an external interrupt, directs the
@@ -266,7 +284,51 @@ intr_context (void) {
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	this_cpu ()->yield_on_return = true;
+}
+
+/* Defers W to run once the external interrupt being processed
+   has been acknowledged, with interrupts on but still in
+   interrupt context, so W may not sleep.  Outside an external
+   interrupt, W waits for the next one.  Returns false, doing
+   nothing, if W is already deferred.  Interrupts must be off. */
+bool
+intr_defer (struct work *w) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (w->pending)
+		return false;
+	w->pending = true;
+	list_push_back (&this_cpu ()->softirqs, &w->elem);
+	return true;
+}
+
+/* Runs the work deferred on C, which must be the running CPU,
+   in the order it was deferred, including work deferred while it
+   runs, up to SOFTIRQ_BUDGET items; hands any more to C's worker
+   thread.  Called with interrupts off; re-enables them around
+   each item. */
+static void
+run_softirqs (struct cpu *c) {
+	int budget = SOFTIRQ_BUDGET;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!c->in_external_intr && !c->in_softirq);
+
+	c->in_softirq = true;
+	while (!list_empty (&c->softirqs)) {
+		struct work *w = list_entry (list_pop_front (&c->softirqs),
+				struct work, elem);
+
+		w->pending = false;
+		if (budget-- > 0) {
+			intr_enable ();
+			w->func (w->aux);
+			intr_disable ();
+		} else
+			work_queue (w);
+	}
+	c->in_softirq = false;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -339,11 +401,17 @@ intr_handler (struct intr_frame *frame) {
 	   An external interrupt handler cannot sleep. */
 	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
 	if (external) {
+		struct cpu *c = this_cpu ();
+
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (!intr_context ());
+		ASSERT (!c->in_external_intr);
 
-		in_external_intr = true;
-		yield_on_return = false;
+		c->in_external_intr = true;
+		if (!c->in_softirq)
+			c->yield_on_return = false;
+
+		/* Catch up on ticks skipped while idling tickless. */
+		timer_idle_exit ();
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -363,14 +431,29 @@ intr_handler (struct intr_frame *frame) {
 
 	/* Complete the processing of an external interrupt. */
 	if (external) {
+		struct cpu *c = this_cpu ();
+
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (intr_context ());
+		ASSERT (c->in_external_intr);
 
-		in_external_intr = false;
+		c->in_external_intr = false;
 		pic_end_of_interrupt (frame->vec_no);
 
-		if (yield_on_return)
-			thread_yield ();
+		if (!c->in_softirq) {
+			if (!list_empty (&c->softirqs))
+				run_softirqs (c);
+			if (c->yield_on_return)
+				thread_yield ();
+		}
+
+#ifdef USERPROG
+		/* A user thread whose process is exiting stops here
+		   rather than return to user mode. */
+		if ((frame->cs & 3) == 3 && uthread_exiting ()) {
+			intr_enable ();
+			uthread_check_exit ();
+		}
+#endif
 	}
 }
 
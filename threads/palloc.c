@@ -10,6 +10,7 @@
 #include "threads/init.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -38,6 +39,11 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* For each page of the user pool, the number of owners it has
+   beyond the first, which copy-on-write fork() adds with
+   palloc_share_page().  Protected by the user pool's lock. */
+static uint16_t *user_shares;
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
@@ -250,6 +256,9 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	user_shares = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP (bitmap_size (user_pool.used_map)
+				* sizeof *user_shares, PGSIZE));
 	return ext_mem.end;
 }
 
@@ -268,6 +277,15 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	lock_release (&pool->lock);
 	void *pages;
 
+	/* Out of kernel pages: give back the thread pages that thread.c
+	   keeps cached for new threads, and try once more. */
+	if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+			&& thread_cache_reclaim () > 0) {
+		lock_acquire (&pool->lock);
+		page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+		lock_release (&pool->lock);
+	}
+
 	if (page_idx != BITMAP_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
@@ -322,12 +340,66 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
 }
 
-/* Frees the page at PAGE. */
+/* Frees the page at PAGE.  If PAGE is a user page with more than
+   one owner, only drops the caller's share of it instead. */
 void
 palloc_free_page (void *page) {
+	if (page_from_pool (&user_pool, page)) {
+		size_t page_idx = pg_no (page) - pg_no (user_pool.base);
+		bool shared;
+
+		lock_acquire (&user_pool.lock);
+		shared = user_shares[page_idx] > 0;
+		if (shared)
+			user_shares[page_idx]--;
+		lock_release (&user_pool.lock);
+		if (shared)
+			return;
+	}
 	palloc_free_multiple (page, 1);
 }
 
+/* Adds an owner to user page PAGE, so that it is only freed once
+   palloc_free_page() has been called once more for it. */
+void
+palloc_share_page (void *page) {
+	size_t page_idx;
+
+	ASSERT (page_from_pool (&user_pool, page));
+	page_idx = pg_no (page) - pg_no (user_pool.base);
+
+	lock_acquire (&user_pool.lock);
+	ASSERT (bitmap_test (user_pool.used_map, page_idx));
+	ASSERT (user_shares[page_idx] < UINT16_MAX);
+	user_shares[page_idx]++;
+	lock_release (&user_pool.lock);
+}
+
+/* Returns true if PAGE is a user page with more than one owner. */
+bool
+palloc_page_shared (void *page) {
+	size_t page_idx;
+	bool shared;
+
+	if (!page_from_pool (&user_pool, page))
+		return false;
+	page_idx = pg_no (page) - pg_no (user_pool.base);
+
+	lock_acquire (&user_pool.lock);
+	shared = user_shares[page_idx] > 0;
+	lock_release (&user_pool.lock);
+	return shared;
+}
+
+/* Returns the number of pages the user pool spans and stores the
+   address of its first page in *BASE.  Every page that
+   palloc_get_page (PAL_USER) returns lies in that range. */
+size_t
+palloc_user_pool (void **base) {
+	*base = user_pool.base;
+	return bitmap_size (user_pool.used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -0,0 +1,120 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#ifdef FILESYS
+#include "filesys/fsutil.h"
+#endif
+
+/* Set by kernel command-line option "-profile". */
+enum profile_mode profile_mode;
+
+/* Header of the dump, directly followed in memory by the sample
+   buffers of all CPU_MAX possible CPUs, so that the first
+   cpu_cnt of them can be written out as they are.  `buffers' is
+   NULL while not profiling. */
+static struct profile_header *header;
+static struct profile_cpu *buffers;
+
+/* Size in bytes of a dump of CPU_CNT CPUs. */
+#define DUMP_SIZE(CPU_CNT) \
+	(sizeof (struct profile_header) + (CPU_CNT) * sizeof (struct profile_cpu))
+
+/* Starts profiling, if "-profile" was given.  Must be called
+   after palloc_init(). */
+void
+profile_init (void) {
+	size_t page_cnt = DIV_ROUND_UP (DUMP_SIZE (CPU_MAX), PGSIZE);
+
+	if (profile_mode == PROFILE_OFF)
+		return;
+
+	header = palloc_get_multiple (PAL_ZERO, page_cnt);
+	if (header == NULL) {
+		printf ("profile: could not allocate %zu pages, not profiling\n",
+				page_cnt);
+		return;
+	}
+	memcpy (header->magic, "PPROF1", 7);
+	header->samples_per_cpu = PROFILE_SAMPLES;
+	header->depth = PROFILE_DEPTH;
+	header->timer_freq = TIMER_FREQ;
+	buffers = (struct profile_cpu *) (header + 1);
+}
+
+/* Records where interrupted frame F was running in the running
+   CPU's sample buffer.  Called by the timer interrupt handler.
+
+   The call stack is walked only within the page that holds the
+   interrupted stack pointer, that is, the interrupted thread's
+   kernel stack, and only toward its top, so a corrupt or
+   missing frame pointer ends the walk instead of faulting. */
+void
+profile_sample (const struct intr_frame *f) {
+	struct profile_cpu *pc;
+	struct profile_sample *s;
+
+	ASSERT (intr_context ());
+
+	if (buffers == NULL)
+		return;
+
+	pc = &buffers[this_cpu ()->id];
+	if (pc->taken >= PROFILE_SAMPLES) {
+		pc->dropped++;
+		return;
+	}
+	s = &pc->samples[pc->taken++];
+	s->pcs[0] = f->rip;
+	s->depth = 1;
+	s->user = f->cs != SEL_KCSEG;
+
+	if (profile_mode == PROFILE_STACK && !s->user) {
+		uint64_t *frame = (uint64_t *) f->R.rbp;
+		uint64_t *stack = (uint64_t *) f->rsp;
+		uint64_t *top = (uint64_t *) ((uint8_t *) pg_round_down (stack) + PGSIZE);
+
+		while (s->depth < PROFILE_DEPTH
+				&& frame >= stack && frame + 2 <= top
+				&& is_kernel_vaddr (frame[1])) {
+			s->pcs[s->depth++] = frame[1];
+			stack = frame + 2;
+			frame = (uint64_t *) frame[0];
+		}
+	}
+}
+
+/* Stops profiling and writes the samples to the scratch disk,
+   where "pintos --profile FILE" expects them: after the trace,
+   if any.  Does nothing if not profiling.  Called by
+   power_off(). */
+void
+profile_dump (void) {
+	enum intr_level old_level;
+
+	if (buffers == NULL)
+		return;
+	old_level = intr_disable ();
+	buffers = NULL;
+	intr_set_level (old_level);
+
+	header->cpu_cnt = cpu_cnt;
+
+#ifdef FILESYS
+	/* A panic powers off with interrupts disabled, and disk I/O
+	   waits for a completion interrupt. */
+	if (intr_context () || old_level == INTR_OFF)
+		printf ("profile: interrupts off, profile not written\n");
+	else if (fsutil_get_buffer ("profile", header, DUMP_SIZE (cpu_cnt)))
+		printf ("profile: wrote %d CPUs' samples to scratch disk\n", cpu_cnt);
+#else
+	printf ("profile: no scratch disk without FILESYS, profile not written\n");
+#endif
+}
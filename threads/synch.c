@@ -27,10 +27,26 @@
    */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
+
+/* Maximum number of times lock_acquire() polls a lock whose
+   holder is running on another CPU before it gives up and
+   blocks. */
+#define LOCK_SPIN_LIMIT 1000
+
+static bool lock_spin (struct lock *);
+static void lock_take (struct lock *);
+static void waiter_push (struct heap *, struct prio_waiter *, int priority);
+static struct prio_waiter *waiter_pop (struct heap *);
+static bool waiter_less (const struct heap_elem *, const struct heap_elem *,
+                         void *aux);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +62,7 @@ sema_init (struct semaphore *sema, unsigned value) {
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -66,14 +82,15 @@ while문에서 sema->waiters(block된 애들이 대기하는 곳)에 우선순
 */
 void
 sema_down (struct semaphore *sema) {
+  struct thread *cur = thread_current ();
   enum intr_level old_level;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
   old_level = intr_disable ();
+  trace_record (TRACE_SEMA_DOWN, (uint64_t) sema, sema->value);
   while (sema->value == 0) {
-    list_insert_ordered (&sema->waiters, &thread_current ()->elem,
-                         compare_priority, NULL);
+    waiter_push (&sema->waiters, &cur->sema_waiter, cur->priority);
     thread_block ();
   }
   sema->value--;
@@ -109,8 +126,8 @@ sema_try_down (struct semaphore *sema) {
    This function may be called from an interrupt handler. */
 /*
 sema up의 신호를 받고 thread를 block에서 꺼냅니다.
-우리는 waiters에 우선순위 순서로 너놓았기 때문에
-waiters의 제일 앞에서 pop해서 thread_unblock을 실행합니다.
+waiters는 우선순위 heap이기 때문에
+가장 높은 우선순위의 thread를 pop해서 thread_unblock을 실행합니다.
 
 그리고 sema의 값을 1을 올려주고
 ready list 첫번째의 thread -> priority와
@@ -125,17 +142,77 @@ sema_up (struct semaphore *sema) {
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) {
-    list_sort (&sema->waiters, compare_priority, NULL);
-    thread_unblock (
-        list_entry (list_pop_front (&sema->waiters), struct thread, elem));
-  }
+  if (!heap_empty (&sema->waiters)) {
+    struct thread *t = heap_entry (&waiter_pop (&sema->waiters)->elem,
+                                   struct thread, sema_waiter.elem);
+    trace_record (TRACE_SEMA_UP, (uint64_t) sema, t->tid);
+    thread_unblock (t);
+  } else
+    trace_record (TRACE_SEMA_UP, (uint64_t) sema, 0);
   sema->value++;
   test_max_priority ();
   
   intr_set_level (old_level);
 }
 
+/* Moves T within the semaphore or condition wait queue it is in,
+   if any, to match T's current priority.  Called whenever T's
+   priority changes.  Interrupts must be off. */
+void
+sema_waiter_requeue (struct thread *t) {
+  struct prio_waiter *waiters[2] = { &t->sema_waiter, t->cond_waiter };
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (int i = 0; i < 2; i++) {
+    struct prio_waiter *w = waiters[i];
+    if (w != NULL && w->queue != NULL && w->priority != t->priority) {
+      struct heap *queue = w->queue;
+      heap_remove (queue, &w->elem);
+      w->priority = t->priority;
+      heap_push (queue, &w->elem);
+    }
+  }
+}
+
+/* Adds W to wait queue QUEUE with the given PRIORITY, behind any
+   entries of equal priority.  Interrupts must be off. */
+static void
+waiter_push (struct heap *queue, struct prio_waiter *w, int priority) {
+  static uint64_t next_seq;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  w->priority = priority;
+  w->seq = next_seq++;
+  w->queue = queue;
+  heap_push (queue, &w->elem);
+}
+
+/* Removes and returns the entry of non-empty wait queue QUEUE
+   that should wake up first.  Interrupts must be off. */
+static struct prio_waiter *
+waiter_pop (struct heap *queue) {
+  struct prio_waiter *w = heap_entry (heap_pop (queue), struct prio_waiter,
+                                      elem);
+
+  w->queue = NULL;
+  return w;
+}
+
+/* Orders wait queue entries: higher priority first, then earlier
+   arrival first. */
+static bool
+waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED) {
+  const struct prio_waiter *a = heap_entry (a_, struct prio_waiter, elem);
+  const struct prio_waiter *b = heap_entry (b_, struct prio_waiter, elem);
+
+  if (a->priority != b->priority)
+    return a->priority > b->priority;
+  return a->seq < b->seq;
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -190,6 +267,8 @@ lock_init (struct lock *lock) {
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->max_pri = PRI_MIN;
+  memset (&lock->stats, 0, sizeof lock->stats);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -221,16 +300,90 @@ lock_acquire (struct lock *lock) {
   ASSERT (!lock_held_by_current_thread (lock));
 	
   struct thread *cur = thread_current ();
-  if (lock->holder) {
-    cur->waitLock = lock;
-    list_insert_ordered (&lock->holder->dona, &cur->dona_elem, compare_priority,
-                         NULL);
-    dona_priority ();
+  uint64_t spin_cycles = 0, block_cycles = 0;
+  bool contended = false;
+
+  if (!sema_try_down (&lock->semaphore)) {
+    bool acquired = false;
+    uint64_t start;
+
+    contended = true;
+    if (cpu_cnt > 1) {
+      start = rdtsc ();
+      acquired = lock_spin (lock);
+      spin_cycles = rdtsc () - start;
+    }
+    if (!acquired) {
+      /* Spinning did not pay off: donate and block as usual. */
+      start = rdtsc ();
+      if (lock->holder && !thread_mlfqs) {
+        cur->waitLock = lock;
+        dona_priority ();
+      }
+
+      sema_down (&lock->semaphore);
+      cur->waitLock = NULL;
+      block_cycles = rdtsc () - start;
+    }
   }
+  lock_take (lock);
+
+  lock->stats.acquires++;
+  lock->stats.contended += contended;
+  lock->stats.spin_cycles += spin_cycles;
+  lock->stats.block_cycles += block_cycles;
+}
+
+/* Makes the current thread the holder of LOCK, which it has just
+   acquired.  The threads still waiting for LOCK donate to the new
+   holder from here on, so LOCK's max_pri starts over from the
+   highest of their priorities. */
+static void
+lock_take (struct lock *lock) {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level = intr_disable ();
 
-  sema_down (&lock->semaphore);
-  cur->waitLock = NULL;
   lock->holder = cur;
+  lock->max_pri = PRI_MIN;
+  if (!heap_empty (&lock->semaphore.waiters))
+    lock->max_pri = heap_entry (heap_top (&lock->semaphore.waiters),
+                                struct prio_waiter, elem)->priority;
+  list_push_back (&cur->held_locks, &lock->held_elem);
+  intr_set_level (old_level);
+}
+
+/* Busy-waits for LOCK, which was found held, for as long as its
+   holder is running on another CPU, since it is then likely to
+   release LOCK sooner than blocking and waking up would take.
+   Gives up after LOCK_SPIN_LIMIT polls, or as soon as the holder
+   is preempted or blocks.  Returns true if LOCK was acquired.
+   Only called with more than one CPU online: on a single CPU the
+   holder cannot be running, so lock_acquire() blocks at once.
+   Only the bootstrap processor is ever brought online for now
+   (see struct cpu), so this never runs yet and spin_cycles stays
+   0.
+
+   A null holder means LOCK is between holders: being released,
+   or taken by a thread that has yet to record itself.  Nothing
+   tells which, so that gets one more try and no spinning.
+
+   The holder is examined without synchronization.  It may exit
+   meanwhile, but thread pages are never unmapped, so the worst
+   outcome is giving up on the spin too early or too late. */
+static bool
+lock_spin (struct lock *lock) {
+  for (int i = 0; i < LOCK_SPIN_LIMIT; i++) {
+    struct thread *holder = lock->holder;
+
+    if (holder == NULL)
+      return sema_try_down (&lock->semaphore);
+    if (holder->status != THREAD_RUNNING || holder->cpu == this_cpu ())
+      return false;
+    asm volatile ("pause");
+    if (sema_try_down (&lock->semaphore))
+      return true;
+  }
+  return false;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -247,8 +400,10 @@ lock_try_acquire (struct lock *lock) {
   ASSERT (!lock_held_by_current_thread (lock));
 
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) {
+    lock_take (lock);
+    lock->stats.acquires++;
+  }
   return success;
 }
 
@@ -260,10 +415,10 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 /*
 Thread L의 할일이 끝났다면 lock을 이제 release 합니다
-lock을 릴리즈할때 remove_lock을 통해서 donation list에서 release 되는 lock과
-동일한 lock을 찾아 지워줌 --> donation list에서 release된 lock의 정보를 지운다
+lock을 릴리즈할때 held_locks에서 release 되는 lock을 지워줌
+--> 해당 lock의 waiter들이 준 donation이 사라진다
 
-그 후 refresh_pri()를 통해서 현재 thread의 초기값 혹은 현재 thread가 받은 priority 중
+그 후 refresh_pri()를 통해서 현재 thread의 초기값 혹은 남은 lock들의 max_pri 중
 가장 큰 값을 적용해주고
 
 현재 thread의 lock->holder를 NULL로 놔준다
@@ -271,13 +426,18 @@ lock을 릴리즈할때 remove_lock을 통해서 donation list에서 release 되
 */
 void
 lock_release (struct lock *lock) {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  remove_lock (lock);
-  refresh_pri ();
-
+  old_level = intr_disable ();
+  list_remove (&lock->held_elem);
+  if (!thread_mlfqs)
+    refresh_pri ();
   lock->holder = NULL;
+  intr_set_level (old_level);
+
   sema_up (&lock->semaphore);
 }
 
@@ -291,6 +451,217 @@ lock_held_by_current_thread (const struct lock *lock) {
   return lock->holder == thread_current ();
 }
 
+/* Initializes readers-writer lock RW as held by nobody. */
+void
+rwlock_init (struct rwlock *rw) {
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  rw->readers = 0;
+  list_init (&rw->reader_holds);
+  list_init (&rw->read_waiters);
+  rw->drainer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  A thread may hold at most RWLOCK_NEST_MAX
+   readers-writer locks for reading at once, and must not acquire
+   one it already holds, since a writer may have started waiting
+   in between.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = NULL;
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  while (rw->lock.holder != NULL
+         || !heap_empty (&rw->lock.semaphore.waiters)) {
+    if (rw->lock.holder != NULL && !thread_mlfqs) {
+      cur->waitLock = &rw->lock;
+      dona_priority ();
+    }
+    list_push_back (&rw->read_waiters, &cur->elem);
+    thread_block ();
+    cur->waitLock = NULL;
+  }
+
+  for (int i = 0; i < RWLOCK_NEST_MAX; i++)
+    if (cur->rd_holds[i].rwlock == NULL) {
+      hold = &cur->rd_holds[i];
+      break;
+    }
+  ASSERT (hold != NULL);
+  hold->rwlock = rw;
+  hold->thread = cur;
+  list_push_back (&rw->reader_holds, &hold->elem);
+  rw->readers++;
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out lets a waiting writer in. */
+void
+rwlock_release_read (struct rwlock *rw) {
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = NULL;
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  for (int i = 0; i < RWLOCK_NEST_MAX; i++)
+    if (cur->rd_holds[i].rwlock == rw) {
+      hold = &cur->rd_holds[i];
+      break;
+    }
+  ASSERT (hold != NULL);
+  list_remove (&hold->elem);
+  hold->rwlock = NULL;
+  if (--rw->readers == 0 && rw->drainer != NULL)
+    thread_unblock (rw->drainer);
+
+  /* Give back the priority a waiting writer donated. */
+  if (!thread_mlfqs)
+    refresh_pri ();
+  test_max_priority ();
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it for reading or writing.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+
+  old_level = intr_disable ();
+
+  /* lock_take() counted only the writers waiting for RW's lock.
+     The readers waiting for it donate to us, too, as they did to
+     the writer before us. */
+  if (!thread_mlfqs) {
+    for (e = list_begin (&rw->read_waiters); e != list_end (&rw->read_waiters);
+         e = list_next (e)) {
+      struct thread *t = list_entry (e, struct thread, elem);
+      if (rw->lock.max_pri < t->priority)
+        rw->lock.max_pri = t->priority;
+    }
+    refresh_pri ();
+  }
+
+  while (rw->readers > 0) {
+    rw->drainer = cur;
+    if (!thread_mlfqs)
+      for (e = list_begin (&rw->reader_holds); e != list_end (&rw->reader_holds);
+           e = list_next (e))
+        thread_donate (list_entry (e, struct rwlock_hold, elem)->thread,
+                       cur->priority);
+    thread_block ();
+  }
+  rw->drainer = NULL;
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Waiting readers are let in unless another writer is waiting. */
+void
+rwlock_release_write (struct rwlock *rw) {
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (lock_held_by_current_thread (&rw->lock));
+
+  old_level = intr_disable ();
+  if (heap_empty (&rw->lock.semaphore.waiters))
+    while (!list_empty (&rw->read_waiters))
+      thread_unblock (list_entry (list_pop_front (&rw->read_waiters),
+                                  struct thread, elem));
+  intr_set_level (old_level);
+
+  lock_release (&rw->lock);
+}
+
+/* Prints LOCK's contention statistics, labeled with NAME. */
+void
+lock_print_stats (const struct lock *lock, const char *name) {
+  const struct lock_stats *s = &lock->stats;
+
+  printf ("Lock %s: %lld acquires, %lld contended, "
+          "%"PRIu64" spin cycles, %"PRIu64" block cycles\n",
+          name, s->acquires, s->contended, s->spin_cycles, s->block_cycles);
+}
+
+/* Initializes spinlock LOCK as not held. */
+void
+spinlock_init (struct spinlock *lock) {
+  ASSERT (lock != NULL);
+
+  lock->locked = 0;
+  lock->holder = NULL;
+}
+
+/* Acquires LOCK, busy-waiting until it becomes available.  The
+   lock must not already be held by the current CPU, and
+   interrupts must be off. */
+void
+spinlock_acquire (struct spinlock *lock) {
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!spinlock_held_by_current_cpu (lock));
+
+  while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+    while (lock->locked)
+      asm volatile ("pause");
+  lock->holder = this_cpu ();
+}
+
+/* Tries to acquire LOCK without busy-waiting and returns true if
+   successful or false on failure.  Interrupts must be off. */
+bool
+spinlock_try_acquire (struct spinlock *lock) {
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+    return false;
+  lock->holder = this_cpu ();
+  return true;
+}
+
+/* Releases LOCK, which must be held by the current CPU. */
+void
+spinlock_release (struct spinlock *lock) {
+  ASSERT (lock != NULL);
+  ASSERT (spinlock_held_by_current_cpu (lock));
+
+  lock->holder = NULL;
+  __atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* Returns true if the current CPU holds LOCK, false otherwise. */
+bool
+spinlock_held_by_current_cpu (const struct spinlock *lock) {
+  ASSERT (lock != NULL);
+
+  return lock->locked && lock->holder == this_cpu ();
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -298,7 +669,7 @@ void
 cond_init (struct condition *cond) {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -323,7 +694,9 @@ cond_init (struct condition *cond) {
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
+  struct thread *cur = thread_current ();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -331,10 +704,13 @@ cond_wait (struct condition *cond, struct lock *lock) {
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
-  // list_push_back (&cond->waiters, &waiter.elem);
-  list_insert_ordered (&cond->waiters, &waiter.elem, compare_sema_priority, 0);
+  old_level = intr_disable ();
+  waiter_push (&cond->waiters, &waiter.waiter, cur->priority);
+  cur->cond_waiter = &waiter.waiter;
+  intr_set_level (old_level);
   lock_release (lock);
   sema_down (&waiter.semaphore);
+  cur->cond_waiter = NULL;
   lock_acquire (lock);
 }
 
@@ -352,10 +728,11 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) {
-    list_sort (&cond->waiters, compare_sema_priority, 0);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)
+  if (!heap_empty (&cond->waiters)) {
+    enum intr_level old_level = intr_disable ();
+    struct prio_waiter *w = waiter_pop (&cond->waiters);
+    intr_set_level (old_level);
+    sema_up (&heap_entry (&w->elem, struct semaphore_elem, waiter.elem)
                   ->semaphore);
   }
 }
@@ -371,28 +748,6 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
-
-/*
-sema_ele 에 대한 크기 priority를 비교하기 위함
-우선순위가 크면 True 작으면 false
-*/
-bool
-compare_sema_priority (const struct list_elem *a, const struct list_elem *b,
-                       void *aux UNUSED) {
-
-  struct semaphore_elem *sa = list_entry (a, struct semaphore_elem, elem);
-  struct semaphore_elem *sb = list_entry (b, struct semaphore_elem, elem);
-
-  struct list *input_sema_list = &(sa->semaphore.waiters);
-  struct list *prev_sema_list = &(sb->semaphore.waiters);
-
-  int input_sema_pri =
-      list_entry (list_begin (input_sema_list), struct thread, elem)->priority;
-  int prev_sema_pri =
-      list_entry (list_begin (prev_sema_list), struct thread, elem)->priority;
-
-  return input_sema_pri > prev_sema_pri;
-}
\ No newline at end of file
@@ -4,12 +4,16 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,12 +28,28 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state wait in the run queue of a CPU
+   (see struct run_queue in cpu.h), one FIFO list per priority
+   level plus an occupancy mask, instead of one list kept sorted
+   on every insertion. */
+#if PRI_MAX - PRI_MIN >= RQ_LEVELS
+#error struct run_queue holds one level per priority
+#endif
+#if SCHED_FIFO_PRI_MAX - SCHED_FIFO_PRI_MIN >= RQ_LEVELS
+#error struct run_queue holds one SCHED_FIFO level per priority
+#endif
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* A thread's rank orders it against ready threads of every
+   scheduling class: SCHED_NORMAL threads rank by priority, from
+   PRI_MIN to PRI_MAX, SCHED_FIFO threads above all of them by
+   their own priority, and SCHED_DEADLINE threads above those.
+   Among SCHED_DEADLINE threads, the earliest deadline wins. */
+#define RANK_FIFO(PRI) (RQ_LEVELS + (PRI))
+#define RANK_DEADLINE (2 * RQ_LEVELS)
+
+/* List of all live threads, linked through `allelem'.  Only the
+   4.4BSD scheduler walks it, once per second. */
+static struct list all_list;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -40,20 +60,65 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
-/* Statistics. */
-static long long idle_ticks;   /* # of timer ticks spent idle. */
-static long long kernel_ticks; /* # of timer ticks in kernel threads. */
-static long long user_ticks;   /* # of timer ticks in user programs. */
-
-/* Scheduling. */
+/* Cache of freed thread pages, so that creating a thread
+   normally does not need to go to the page allocator.  The cache
+   is a stack of free blocks linked through their first word and
+   holds at most `max' of them; further frees go back to palloc.
+   thread_cache_reclaim() empties it when the kernel pool runs
+   out.  Accessed with interrupts off, since thread pages are
+   freed from inside the scheduler. */
+struct page_cache {
+  void *free;               /* First free block, or NULL. */
+  int cnt;                  /* # of blocks in the cache. */
+  int max;                  /* Maximum # of blocks to keep. */
+  size_t page_cnt;          /* # of pages per block. */
+  long long hits;           /* # of allocations served from cache. */
+  long long misses;         /* # of allocations passed to palloc. */
+};
+
+static struct page_cache thread_page_cache = { NULL, 0, 16, 1, 0, 0 };
+
+/* Scheduling.  The time slice counter and tick statistics are
+   kept per CPU, in struct cpu. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
-static unsigned thread_ticks; /* # of timer ticks since last yield. */
+
+/* Admission control for SCHED_DEADLINE.  A thread's bandwidth is
+   runtime / period, scaled by DL_BW_ONE, and the bandwidths of
+   all SCHED_DEADLINE threads together may reserve at most
+   DL_BW_LIMIT percent of every CPU, so that lower classes never
+   starve outright.  Accessed with interrupts off. */
+#define DL_BW_ONE (1 << 20)
+#define DL_BW_LIMIT 95
+static int64_t dl_bw_total;
+
+/* Throttling for SCHED_FIFO threads of user processes, which any
+   program may become.  Together they may run at most RT_RUNTIME
+   ticks of every RT_PERIOD on a CPU, then sleep until the period
+   ends, so that SCHED_NORMAL threads never starve outright.
+   Kernel threads are not throttled. */
+#define RT_PERIOD TIMER_FREQ
+#define RT_RUNTIME (RT_PERIOD / 100 * DL_BW_LIMIT)
+
+/* 4.4BSD scheduler. */
+#define PRI_RECALC_TICKS 4    /* # of timer ticks between priority updates. */
+static fixed_t load_avg;      /* System load average. */
+
+/* Threads whose `recent_cpu' changed since the last priority
+   update, linked through `dirty_elem'.  Only these need a new
+   priority every PRI_RECALC_TICKS ticks; everybody else's inputs
+   change only once per second, when all priorities are
+   recomputed anyway. */
+static struct list mlfqs_dirty;
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Context switch primitives, in switch.S. */
+void switch_context (uint64_t **cur_rsp, uint64_t *next_rsp);
+void switch_to_new (uint64_t **cur_rsp, struct intr_frame *tf);
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -62,11 +127,37 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule (int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void run_queue_init (struct run_queue *);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (struct run_queue *);
+static struct thread *pop_level (struct list levels[], uint64_t *mask);
+static int ready_queue_max_rank (struct run_queue *);
+static bool ready_queue_preempts (struct run_queue *, const struct thread *);
+static int thread_rank (const struct thread *);
+static bool rt_throttled (const struct thread *);
+static bool deadline_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
+static void dl_replenish (struct thread *, int64_t now);
+static void ready_queue_requeue (struct thread *);
+static void thread_requeue (struct thread *);
+static void account_switch (struct thread *curr, struct thread *next);
+static void *page_cache_get (struct page_cache *, enum palloc_flags);
+static void page_cache_put (struct page_cache *, void *);
+static size_t page_cache_drain (struct page_cache *);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_second (void);
+static void mlfqs_update_dirty (void);
+static void mlfqs_update_priority (struct thread *);
+static int mlfqs_priority (const struct thread *);
 void test_max_priority (void);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
+/* Returns true if T is the idle thread of the CPU it runs on. */
+#define is_idle(t) ((t) == (t)->cpu->idle_thread)
+
 /* Returns the running thread.
  * Read the CPU's stack pointer `rsp', and then round that
  * down to the start of a page.  Since `struct thread' is
@@ -105,13 +196,17 @@ thread_init (void) {
 
   /* Init the globla thread context */
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  list_init (&all_list);
+  list_init (&mlfqs_dirty);
   list_init (&destruction_req);
 
-  /* Set up a thread structure for the running thread. */
+  /* Set up a thread structure for the running thread, and bring
+     the bootstrap processor online with it. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  run_queue_init (&cpus[0].rq);
+  cpu_init (initial_thread);
   initial_thread->tid = allocate_tid ();
 
 }
@@ -132,32 +227,95 @@ thread_start (void) {
   sema_down (&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+/* Called by the timer interrupt handler at each timer tick, with
+   the frame F of the code it interrupted.  Thus, this function
+   runs in an external interrupt context. */
 void
-thread_tick (void) {
+thread_tick (const struct intr_frame *f) {
   struct thread *t = thread_current ();
+  struct cpu *c = t->cpu;
+
+  /* Update statistics.  A user process's time in system calls
+     and page faults counts as kernel time. */
+  if (is_idle (t))
+    c->idle_ticks++;
+  else if (f->cs != SEL_KCSEG) {
+    c->user_ticks++;
+    t->stats.user_ticks++;
+  } else {
+    c->kernel_ticks++;
+    t->stats.kernel_ticks++;
+  }
+
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
+  /* Charge the tick against a SCHED_DEADLINE thread's budget.
+     Once it runs out, thread_yield() throttles the thread until
+     its deadline. */
+  if (t->sched_class == SCHED_DEADLINE && --t->dl_budget <= 0)
+    intr_yield_on_return ();
 
-  /* Update statistics. */
-  if (t == idle_thread)
-    idle_ticks++;
+  /* Likewise charge a user SCHED_FIFO thread's tick against this
+     CPU's real-time period, starting a new one if it is over. */
+  if (timer_ticks () >= c->rt_period_end) {
+    c->rt_period_end = timer_ticks () + RT_PERIOD;
+    c->rt_ticks = 0;
+  }
 #ifdef USERPROG
-  else if (t->pml4 != NULL)
-    user_ticks++;
+  if (t->sched_class == SCHED_FIFO && t->pml4 != NULL)
+    c->rt_ticks++;
 #endif
-  else
-    kernel_ticks++;
+  if (rt_throttled (t))
+    intr_yield_on_return ();
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  /* Enforce preemption.  Real-time threads have no time slice:
+     they run until they block, yield, or a higher-ranked thread
+     becomes ready. */
+  if (++c->thread_ticks >= TIME_SLICE && t->sched_class == SCHED_NORMAL)
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Accounts TICKS timer ticks that elapsed while the CPU idled
+   without a periodic timer interrupt toward the idle time.  See
+   timer_idle_enter(). */
+void
+thread_add_idle_ticks (int64_t ticks) {
+  this_cpu ()->idle_ticks += ticks;
+}
+
+/* Prints thread statistics, summed over all CPUs, followed by
+   each live thread's own CPU accounting. */
 void
 thread_print_stats (void) {
+  long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+  struct list_elem *e;
+
+  for (int i = 0; i < cpu_cnt; i++) {
+    idle_ticks += cpus[i].idle_ticks;
+    kernel_ticks += cpus[i].kernel_ticks;
+    user_ticks += cpus[i].user_ticks;
+  }
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread cache: %lld hits, %lld misses\n",
+          thread_page_cache.hits, thread_page_cache.misses);
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e)) {
+    struct thread *t = list_entry (e, struct thread, allelem);
+    const struct thread_stats *s = &t->stats;
+
+    printf ("Thread %s (%d): %lld user ticks, %lld kernel ticks, "
+            "%lld voluntary and %lld involuntary switches\n",
+            t->name, t->tid, s->user_ticks, s->kernel_ticks,
+            s->voluntary_switches, s->involuntary_switches);
+    for (int i = 0; i < THREAD_WAIT_BUCKETS; i++)
+      if (s->wait_hist[i] != 0)
+        printf ("  ready wait %s2^%d cycles: %lld\n",
+                i == THREAD_WAIT_BUCKETS - 1 ? ">= " : "",
+                i, s->wait_hist[i]);
+  }
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -183,8 +341,10 @@ thread_create (const char *name, int priority, thread_func *function,
 
   ASSERT (function != NULL);
 
-  /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  /* Allocate thread.  init_thread() clears the struct thread at
+     the bottom of the page, and the rest is stack, so the page
+     need not be zeroed. */
+  t = page_cache_get (&thread_page_cache, 0);
   if (t == NULL)
     return TID_ERROR;
 
@@ -204,14 +364,6 @@ thread_create (const char *name, int priority, thread_func *function,
   t->tf.eflags = FLAG_IF;
 
   /* for project 2 -- start*/
-  t->fd_table = palloc_get_multiple(PAL_ZERO, FD_PAGES);
-  if (t->fd_table == NULL)
-    return TID_ERROR;
-  
-  t->fd_table[0]=1; // stdin 자리
-  t->fd_table[1]=2; // stdout 자리
-  t->fd_idx = 2;
-
   struct thread *cur = thread_current();
   list_push_back(&cur->child_s, &t->child_elem);
 
@@ -235,6 +387,7 @@ void
 thread_block (void) {
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
+  trace_record (TRACE_BLOCK, 0, 0);
   thread_current ()->status = THREAD_BLOCKED;
   schedule ();
 }
@@ -250,7 +403,7 @@ thread_block (void) {
 
 /*
 Thread가 block에서 깨어나 ready list로 들어갑니다.
-block에서 ready_list로 들어갈 때 우선 순위에 맞춰서 들어간다
+block에서 ready queue로 들어갈 때 자신의 우선 순위 queue 끝에 들어간다
 */
 void
 thread_unblock (struct thread *t) {
@@ -260,7 +413,18 @@ thread_unblock (struct thread *t) {
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_insert_ordered (&ready_list, &t->elem, compare_priority, NULL);
+  trace_record (TRACE_UNBLOCK, t->tid, 0);
+  if (t->sched_class == SCHED_DEADLINE) {
+    /* Constant bandwidth server wake-up rule: keep the current
+       deadline and budget only if running out the budget by the
+       deadline would not exceed the reserved bandwidth. */
+    int64_t now = timer_ticks ();
+    if (now >= t->dl_deadline
+        || t->dl_budget * t->dl_period > (t->dl_deadline - now) * t->dl_runtime)
+      dl_replenish (t, now);
+  }
+  t->ready_since = rdtsc ();
+  ready_queue_push (t);
 
   t->status = THREAD_READY;
   intr_set_level (old_level);
@@ -309,6 +473,11 @@ thread_exit (void) {
   /* Just set our status to dying and schedule another process.
      We will be destroyed during the call to schedule_tail(). */
   intr_disable ();
+  list_remove (&thread_current ()->allelem);
+  if (thread_current ()->mlfqs_dirty)
+    list_remove (&thread_current ()->dirty_elem);
+  if (thread_current ()->sched_class == SCHED_DEADLINE)
+    dl_bw_total -= thread_current ()->dl_bw;
   do_schedule (THREAD_DYING);
   NOT_REACHED ();
 }
@@ -317,8 +486,8 @@ thread_exit (void) {
    may be scheduled again immediately at the scheduler's whim. */
 
 /*
-thread_yield는 현재 돌고 있는 thread를 ready_list로 보내고
-ready_list에 있는 첫번째를 꺼내서 launch를 합니다
+thread_yield는 현재 돌고 있는 thread를 ready queue로 보내고
+가장 높은 우선 순위 queue의 첫번째를 꺼내서 launch를 합니다
 */
 void
 thread_yield (void) {
@@ -327,9 +496,27 @@ thread_yield (void) {
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (curr != idle_thread) {
-    list_insert_ordered (&ready_list, &curr->elem, compare_priority, NULL);
-    // ready list에 thread를 넣을때 우선 순위가 높은 순서로 맞춰서 넣는다
+  if (curr->sched_class == SCHED_DEADLINE && curr->dl_budget <= 0) {
+    /* Out of budget: throttled until the deadline, when
+       thread_unblock() hands out the next period's budget. */
+    int64_t now = timer_ticks ();
+    if (now < curr->dl_deadline) {
+      timer_block_until (curr->dl_deadline);
+      intr_set_level (old_level);
+      return;
+    }
+    dl_replenish (curr, now);
+  }
+  if (rt_throttled (curr)) {
+    /* Out of real-time ticks on this CPU: throttled until the
+       period ends. */
+    timer_block_until (curr->cpu->rt_period_end);
+    intr_set_level (old_level);
+    return;
+  }
+  if (!is_idle (curr)) {
+    curr->ready_since = rdtsc ();
+    ready_queue_push (curr);
   }
 
   do_schedule (THREAD_READY);
@@ -339,24 +526,33 @@ thread_yield (void) {
 
 /*
 test_max_priority
-redy list가 비어있지 않을때 current_thred의 priority와
-ready의 첫번째 thread의 priority를 비교해서
+ready queue가 비어있지 않을때 current_thread의 priority와
+ready queue에서 가장 높은 priority를 비교해서
 
-ready_list의 thread priority가 크다면
+ready queue의 priority가 크다면
 --> thread_yield를 실행한다
-(현재 thread는 ready로 ready의 첫번째를 running으로 옮김)
+(interrupt context 라면 interrupt return 시점에 yield)
 
-ready_list는 항상 우선순위가 높은 순서로 정렬됨
+run queue mask의 최상위 bit가 곧 가장 높은 priority
 */
 void
 test_max_priority (void) {
-  if (!list_empty (&ready_list)) {
-    if (list_entry (list_begin (&ready_list), struct thread, elem)->priority >
-        thread_current ()->priority) {
-      if (thread_current () != idle_thread) {
-        thread_yield ();
-      }
-    }
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool preempt;
+
+  if (is_idle (cur))
+    return;
+
+  old_level = intr_disable ();
+  preempt = ready_queue_preempts (&cur->cpu->rq, cur);
+  intr_set_level (old_level);
+
+  if (preempt) {
+    if (intr_context ())
+      intr_yield_on_return ();
+    else
+      thread_yield ();
   }
 }
 
@@ -392,6 +588,17 @@ thread가 받은 donation의 우선순위와 비교하여
 */
 void
 thread_set_priority (int new_priority) {
+  /* The 4.4BSD scheduler computes priorities by itself. */
+  if (thread_mlfqs)
+    return;
+
+  /* A real-time thread keeps PRI_MAX until it returns to
+     SCHED_NORMAL. */
+  if (thread_current ()->sched_class != SCHED_NORMAL) {
+    thread_current ()->normal_pri = new_priority;
+    return;
+  }
+
   thread_current ()->init_pri = new_priority;
 
   refresh_pri ();
@@ -406,31 +613,229 @@ thread_get_priority (void) {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Moves the current thread to the scheduling class given by
+   ATTR, with its parameters.  Returns true if successful, false
+   if ATTR is invalid or, for SCHED_DEADLINE, if reserving its
+   bandwidth would overcommit the CPUs.
+
+   A real-time thread runs at priority PRI_MAX as far as locks,
+   semaphores and condition variables are concerned, so that it
+   donates PRI_MAX to a SCHED_NORMAL lock holder in its way.  It
+   is never aged by the 4.4BSD scheduler.  New threads always
+   start in SCHED_NORMAL. */
+bool
+thread_set_sched (const struct sched_attr *attr) {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t bw = 0;
+
+  switch (attr->sched_class) {
+  case SCHED_NORMAL:
+    break;
+  case SCHED_FIFO:
+    if (attr->priority < SCHED_FIFO_PRI_MIN
+        || attr->priority > SCHED_FIFO_PRI_MAX)
+      return false;
+    break;
+  case SCHED_DEADLINE:
+    if (attr->runtime <= 0 || attr->runtime > attr->period)
+      return false;
+    bw = (int64_t) attr->runtime * DL_BW_ONE / attr->period;
+    break;
+  default:
+    return false;
+  }
+
+  old_level = intr_disable ();
+  if (cur->sched_class == SCHED_DEADLINE)
+    dl_bw_total -= cur->dl_bw;
+  if (dl_bw_total + bw > (int64_t) cpu_cnt * DL_BW_ONE / 100 * DL_BW_LIMIT) {
+    if (cur->sched_class == SCHED_DEADLINE)
+      dl_bw_total += cur->dl_bw;
+    intr_set_level (old_level);
+    return false;
+  }
+  dl_bw_total += bw;
+
+  if (cur->sched_class == SCHED_NORMAL && attr->sched_class != SCHED_NORMAL) {
+    cur->normal_pri = cur->init_pri;
+    cur->init_pri = PRI_MAX;
+  } else if (cur->sched_class != SCHED_NORMAL
+             && attr->sched_class == SCHED_NORMAL)
+    cur->init_pri = thread_mlfqs ? mlfqs_priority (cur) : cur->normal_pri;
+
+  cur->sched_class = attr->sched_class;
+  cur->fifo_pri = attr->priority;
+  cur->dl_runtime = attr->runtime;
+  cur->dl_period = attr->period;
+  cur->dl_bw = bw;
+  if (cur->sched_class == SCHED_DEADLINE)
+    dl_replenish (cur, timer_ticks ());
+  refresh_pri ();
+  intr_set_level (old_level);
+
+  test_max_priority ();
+  return true;
+}
+
+/* Returns true if T is a user SCHED_FIFO thread and its CPU's
+   user SCHED_FIFO threads have used up the current period. */
+static bool
+rt_throttled (const struct thread *t) {
+  bool user = false;
+
+#ifdef USERPROG
+  user = t->pml4 != NULL;
+#endif
+  return user && t->sched_class == SCHED_FIFO
+         && t->cpu->rt_ticks >= RT_RUNTIME
+         && timer_ticks () < t->cpu->rt_period_end;
+}
+
+/* Starts a new period for SCHED_DEADLINE thread T at tick NOW:
+   a full budget and a deadline one period away. */
+static void
+dl_replenish (struct thread *t, int64_t now) {
+  t->dl_deadline = now + t->dl_period;
+  t->dl_budget = t->dl_runtime;
+}
+
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest one. */
 void
-thread_set_nice (int nice UNUSED) {
-  /* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs) {
+    mlfqs_update_priority (cur);
+    test_max_priority ();
+  }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-  /* TODO: Your implementation goes here */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-  /* TODO: Your implementation goes here */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fp_to_int_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-  /* TODO: Your implementation goes here */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent = fp_to_int_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+  return recent;
+}
+
+/* 4.4BSD scheduler work for one timer tick, in interrupt
+   context: charges the tick to the running thread, decays
+   `recent_cpu' and updates `load_avg' once per second, and
+   refreshes the priorities of threads that ran lately every
+   PRI_RECALC_TICKS ticks. */
+static void
+mlfqs_tick (struct thread *t) {
+  int64_t now = timer_ticks ();
+
+  if (!is_idle (t) && t->sched_class == SCHED_NORMAL) {
+    t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+    if (!t->mlfqs_dirty) {
+      t->mlfqs_dirty = true;
+      list_push_back (&mlfqs_dirty, &t->dirty_elem);
+    }
+  }
+
+  if (now % TIMER_FREQ == 0)
+    mlfqs_update_second ();
+  else if (now % PRI_RECALC_TICKS == 0)
+    mlfqs_update_dirty ();
+  else
+    return;
+
+  test_max_priority ();
+}
+
+/* Once-per-second update: recomputes `load_avg', then decays
+   every thread's `recent_cpu' and recomputes its priority. */
+static void
+mlfqs_update_second (void) {
+  struct list_elem *e;
+  fixed_t decay;
+  int ready_threads = 0;
+
+  for (int i = 0; i < cpu_cnt; i++)
+    ready_threads += cpus[i].rq.cnt + !is_idle (cpus[i].curr);
+
+  load_avg = fp_add (fp_mul (fp_div_int (int_to_fp (59), 60), load_avg),
+                     fp_mul_int (fp_div_int (int_to_fp (1), 60), ready_threads));
+
+  decay = fp_div (fp_mul_int (load_avg, 2), fp_add_int (fp_mul_int (load_avg, 2), 1));
+  for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+    struct thread *t = list_entry (e, struct thread, allelem);
+    if (is_idle (t))
+      continue;
+    t->recent_cpu = fp_add_int (fp_mul (decay, t->recent_cpu), t->nice);
+    mlfqs_update_priority (t);
+  }
+
+  /* Every priority is current again. */
+  while (!list_empty (&mlfqs_dirty))
+    list_entry (list_pop_front (&mlfqs_dirty), struct thread, dirty_elem)
+        ->mlfqs_dirty = false;
+}
+
+/* Recomputes the priority of each thread whose `recent_cpu'
+   changed since the last update. */
+static void
+mlfqs_update_dirty (void) {
+  while (!list_empty (&mlfqs_dirty)) {
+    struct thread *t =
+        list_entry (list_pop_front (&mlfqs_dirty), struct thread, dirty_elem);
+    t->mlfqs_dirty = false;
+    mlfqs_update_priority (t);
+  }
+}
+
+/* Returns PRI_MAX - (recent_cpu / 4) - (nice * 2) for T,
+   clamped to the valid priority range. */
+static int
+mlfqs_priority (const struct thread *t) {
+  int pri = fp_to_int (fp_sub (int_to_fp (PRI_MAX),
+                               fp_div_int (t->recent_cpu, 4)))
+            - t->nice * 2;
+
+  if (pri < PRI_MIN)
+    return PRI_MIN;
+  if (pri > PRI_MAX)
+    return PRI_MAX;
+  return pri;
+}
+
+/* Recomputes T's priority and moves T to the matching run queue
+   if it is ready.  Real-time threads keep PRI_MAX.  Interrupts
+   must be off. */
+static void
+mlfqs_update_priority (struct thread *t) {
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->sched_class != SCHED_NORMAL)
+    return;
+  t->priority = t->init_pri = mlfqs_priority (t);
+  thread_requeue (t);
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -446,7 +851,7 @@ static void
 idle (void *idle_started_ UNUSED) {
   struct semaphore *idle_started = idle_started_;
 
-  idle_thread = thread_current ();
+  this_cpu ()->idle_thread = thread_current ();
   sema_up (idle_started);
 
   for (;;) {
@@ -454,6 +859,10 @@ idle (void *idle_started_ UNUSED) {
     intr_disable ();
     thread_block ();
 
+    /* In tickless mode, stop the periodic tick until the next
+       wake-up deadline. */
+    timer_idle_enter ();
+
     /* Re-enable interrupts and wait for the next one.
 
        The `sti' instruction disables interrupts until the
@@ -483,6 +892,8 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -497,8 +908,7 @@ init_thread (struct thread *t, const char *name, int priority) {
   /*for project -1 start*/
   t->init_pri = priority;
   t->waitLock = NULL;
-  list_init (&t->dona);
-  // list_init (&t->dona_elem);
+  list_init (&t->held_locks);
   /*for project -1 end*/
 
   /* for project -2 start */
@@ -509,6 +919,25 @@ init_thread (struct thread *t, const char *name, int priority) {
   
   /* for project -2 end */
 
+  /* A new thread starts out on its creator's CPU. */
+  if (t != initial_thread)
+    t->cpu = this_cpu ();
+
+  /* The 4.4BSD scheduler ignores PRIORITY: a new thread inherits
+     its creator's nice and recent_cpu and starts from the
+     priority they yield. */
+  if (thread_mlfqs) {
+    if (t != initial_thread) {
+      t->nice = thread_current ()->nice;
+      t->recent_cpu = thread_current ()->recent_cpu;
+    }
+    t->priority = t->init_pri = mlfqs_priority (t);
+  }
+
+  old_level = intr_disable ();
+  list_push_back (&all_list, &t->allelem);
+  intr_set_level (old_level);
+
 
 }
 
@@ -519,10 +948,202 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-  if (list_empty (&ready_list))
-    return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  struct cpu *c = this_cpu ();
+  struct thread *next = ready_queue_pop (&c->rq);
+
+  return next != NULL ? next : c->idle_thread;
+}
+
+/* Initializes RQ as an empty run queue. */
+static void
+run_queue_init (struct run_queue *rq) {
+  spinlock_init (&rq->lock);
+  for (int pri = 0; pri < RQ_LEVELS; pri++) {
+    list_init (&rq->levels[pri]);
+    list_init (&rq->fifo_levels[pri]);
+  }
+  rq->mask = 0;
+  rq->fifo_mask = 0;
+  list_init (&rq->deadline);
+  rq->cnt = 0;
+}
+
+/* Appends T to the tail of the level for its current priority in
+   the run queue of T's CPU, keeping FIFO order among threads of
+   equal priority.  A SCHED_FIFO thread goes to the level for its
+   SCHED_FIFO priority instead, and a SCHED_DEADLINE thread into
+   deadline order, after any with the same deadline.  Interrupts
+   must be off. */
+static void
+ready_queue_push (struct thread *t) {
+  struct run_queue *rq = &t->cpu->rq;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  spinlock_acquire (&rq->lock);
+  switch (t->sched_class) {
+  case SCHED_NORMAL:
+    t->ready_pri = t->priority;
+    list_push_back (&rq->levels[t->ready_pri], &t->elem);
+    rq->mask |= 1ULL << t->ready_pri;
+    break;
+  case SCHED_FIFO:
+    t->ready_pri = t->fifo_pri;
+    list_push_back (&rq->fifo_levels[t->ready_pri], &t->elem);
+    rq->fifo_mask |= 1ULL << t->ready_pri;
+    break;
+  case SCHED_DEADLINE:
+    list_insert_ordered (&rq->deadline, &t->elem, deadline_less, NULL);
+    break;
+  }
+  rq->cnt++;
+  spinlock_release (&rq->lock);
+}
+
+/* Unlinks ready thread T from the run queue it was pushed onto.
+   Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t) {
+  struct run_queue *rq = &t->cpu->rq;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  spinlock_acquire (&rq->lock);
+  list_remove (&t->elem);
+  if (t->sched_class == SCHED_NORMAL
+      && list_empty (&rq->levels[t->ready_pri]))
+    rq->mask &= ~(1ULL << t->ready_pri);
+  else if (t->sched_class == SCHED_FIFO
+           && list_empty (&rq->fifo_levels[t->ready_pri]))
+    rq->fifo_mask &= ~(1ULL << t->ready_pri);
+  rq->cnt--;
+  spinlock_release (&rq->lock);
+}
+
+/* Removes and returns the oldest thread of the highest non-empty
+   level of LEVELS, whose occupancy is *MASK.  RQ's lock must be
+   held and *MASK must not be 0. */
+static struct thread *
+pop_level (struct list levels[], uint64_t *mask) {
+  int pri = 63 - __builtin_clzll (*mask);
+  struct thread *t =
+      list_entry (list_pop_front (&levels[pri]), struct thread, elem);
+
+  if (list_empty (&levels[pri]))
+    *mask &= ~(1ULL << pri);
+  return t;
+}
+
+/* Removes and returns the highest-ranked thread of RQ, the oldest
+   one among equals, or a null pointer if RQ is empty.  The
+   SCHED_DEADLINE list outranks everything else, earliest
+   deadline first.  Interrupts must be off. */
+static struct thread *
+ready_queue_pop (struct run_queue *rq) {
+  struct thread *t = NULL;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  spinlock_acquire (&rq->lock);
+  if (!list_empty (&rq->deadline))
+    t = list_entry (list_pop_front (&rq->deadline), struct thread, elem);
+  else if (rq->fifo_mask != 0)
+    t = pop_level (rq->fifo_levels, &rq->fifo_mask);
+  else if (rq->mask != 0)
+    t = pop_level (rq->levels, &rq->mask);
+  if (t != NULL)
+    rq->cnt--;
+  spinlock_release (&rq->lock);
+  return t;
+}
+
+/* Returns the highest rank among threads in RQ, or -1 if RQ is
+   empty.  This reads only a few words, so it does not need RQ's
+   lock, but the answer may be stale by the time the caller looks
+   at it unless the lock is held. */
+static int
+ready_queue_max_rank (struct run_queue *rq) {
+  uint64_t mask;
+
+  if (!list_empty (&rq->deadline))
+    return RANK_DEADLINE;
+  mask = rq->fifo_mask;
+  if (mask != 0)
+    return RANK_FIFO (63 - __builtin_clzll (mask));
+  mask = rq->mask;
+  if (mask == 0)
+    return -1;
+  return 63 - __builtin_clzll (mask);
+}
+
+/* Returns true if RQ holds a thread that should preempt T: one
+   of higher rank, or, if T is a SCHED_DEADLINE thread, one with
+   an earlier deadline.  Interrupts must be off. */
+static bool
+ready_queue_preempts (struct run_queue *rq, const struct thread *t) {
+  int rank = ready_queue_max_rank (rq);
+  bool preempt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (rank != RANK_DEADLINE || t->sched_class != SCHED_DEADLINE)
+    return rank > thread_rank (t);
+
+  spinlock_acquire (&rq->lock);
+  preempt = !list_empty (&rq->deadline)
+            && list_entry (list_front (&rq->deadline), struct thread, elem)
+                   ->dl_deadline < t->dl_deadline;
+  spinlock_release (&rq->lock);
+  return preempt;
+}
+
+/* Returns T's rank; see RANK_FIFO and RANK_DEADLINE. */
+static int
+thread_rank (const struct thread *t) {
+  switch (t->sched_class) {
+  case SCHED_FIFO:
+    return RANK_FIFO (t->fifo_pri);
+  case SCHED_DEADLINE:
+    return RANK_DEADLINE;
+  default:
+    return t->priority;
+  }
+}
+
+/* Orders SCHED_DEADLINE threads by deadline. */
+static bool
+deadline_less (const struct list_elem *a_, const struct list_elem *b_,
+               void *aux UNUSED) {
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->dl_deadline < b->dl_deadline;
+}
+
+/* Moves ready thread T to the run queue level matching its
+   current priority, after the priority was changed from outside
+   (e.g. by donation).  Does nothing if T is not on a run queue,
+   or is a real-time thread, whose place does not depend on its
+   priority.  Interrupts must be off. */
+static void
+ready_queue_requeue (struct thread *t) {
+  if (t->status != THREAD_READY || t->sched_class != SCHED_NORMAL
+      || t->ready_pri == t->priority)
+    return;
+  ready_queue_remove (t);
+  ready_queue_push (t);
+}
+
+/* Moves T to the position matching its current priority in
+   whichever queue it waits in: a run queue, or a semaphore or
+   condition variable's waiters.  Interrupts must be off. */
+static void
+thread_requeue (struct thread *t) {
+  ready_queue_requeue (t);
+  sema_waiter_requeue (t);
 }
 
 /* Use iretq to launch the thread */
@@ -554,74 +1175,26 @@ do_iret (struct intr_frame *tf) {
                    : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
+/* Switches from the running thread to TH.  schedule() has already
+   activated TH's page tables and queued the previous thread for
+   destruction if it is dying.
 
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   TH resumes where it last called thread_launch(), having saved
+   only the registers a function call preserves (see switch.S).
+   A thread that has never run starts from the interrupt frame
+   set up by thread_create() instead.  Either way, the running
+   thread's own context is saved so that a later thread_launch()
+   returns here.  Interrupts must be off. */
 static void
 thread_launch (struct thread *th) {
-  uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-  uint64_t tf = (uint64_t) &th->tf;
+  struct thread *cur = running_thread ();
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* The main switching logic.
-   * We first restore the whole execution context into the intr_frame
-   * and then switching to the next thread by calling do_iret.
-   * Note that, we SHOULD NOT use any stack from here
-   * until switching is done. */
-  __asm __volatile(
-      /* Store registers that will be used. */
-      "push %%rax\n"
-      "push %%rbx\n"
-      "push %%rcx\n"
-      /* Fetch input once */
-      "movq %0, %%rax\n"
-      "movq %1, %%rcx\n"
-      "movq %%r15, 0(%%rax)\n"
-      "movq %%r14, 8(%%rax)\n"
-      "movq %%r13, 16(%%rax)\n"
-      "movq %%r12, 24(%%rax)\n"
-      "movq %%r11, 32(%%rax)\n"
-      "movq %%r10, 40(%%rax)\n"
-      "movq %%r9, 48(%%rax)\n"
-      "movq %%r8, 56(%%rax)\n"
-      "movq %%rsi, 64(%%rax)\n"
-      "movq %%rdi, 72(%%rax)\n"
-      "movq %%rbp, 80(%%rax)\n"
-      "movq %%rdx, 88(%%rax)\n"
-      "pop %%rbx\n"   // Saved rcx
-      "movq %%rbx, 96(%%rax)\n"
-      "pop %%rbx\n"   // Saved rbx
-      "movq %%rbx, 104(%%rax)\n"
-      "pop %%rbx\n"   // Saved rax
-      "movq %%rbx, 112(%%rax)\n"
-      "addq $120, %%rax\n"
-      "movw %%es, (%%rax)\n"
-      "movw %%ds, 8(%%rax)\n"
-      "addq $32, %%rax\n"
-      "call __next\n"   // read the current rip.
-      "__next:\n"
-      "pop %%rbx\n"
-      "addq $(out_iret -  __next), %%rbx\n"
-      "movq %%rbx, 0(%%rax)\n"   // rip
-      "movw %%cs, 8(%%rax)\n"    // cs
-      "pushfq\n"
-      "popq %%rbx\n"
-      "mov %%rbx, 16(%%rax)\n"   // eflags
-      "mov %%rsp, 24(%%rax)\n"   // rsp
-      "movw %%ss, 32(%%rax)\n"
-      "mov %%rcx, %%rdi\n"
-      "call do_iret\n"
-      "out_iret:\n"
-      :
-      : "g"(tf_cur), "g"(tf)
-      : "memory");
+  if (th->switch_rsp != NULL)
+    switch_context (&cur->switch_rsp, th->switch_rsp);
+  else
+    switch_to_new (&cur->switch_rsp, &th->tf);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -635,12 +1208,35 @@ do_schedule (int status) {
   while (!list_empty (&destruction_req)) {
     struct thread *victim =
         list_entry (list_pop_front (&destruction_req), struct thread, elem);
-    palloc_free_page (victim);
+    page_cache_put (&thread_page_cache, victim);
   }
   thread_current ()->status = status;
   schedule ();
 }
 
+/* Updates the context switch counts of CURR, which is being
+   switched out, and the ready-to-run wait histogram of NEXT,
+   which is being switched in.  A thread that is still ready
+   when switched out was preempted or yielded; anything else
+   gave up the CPU of its own accord. */
+static void
+account_switch (struct thread *curr, struct thread *next) {
+  if (curr->status == THREAD_READY)
+    curr->stats.involuntary_switches++;
+  else
+    curr->stats.voluntary_switches++;
+
+  if (next->ready_since != 0) {
+    uint64_t wait = rdtsc () - next->ready_since;
+    int bucket = wait != 0 ? 63 - __builtin_clzll (wait) : 0;
+
+    if (bucket >= THREAD_WAIT_BUCKETS)
+      bucket = THREAD_WAIT_BUCKETS - 1;
+    next->stats.wait_hist[bucket]++;
+    next->ready_since = 0;
+  }
+}
+
 static void
 schedule (void) {
   struct thread *curr = running_thread ();
@@ -649,11 +1245,19 @@ schedule (void) {
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (curr->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
+  if (curr != next)
+    trace_record (TRACE_SCHEDULE, curr->tid, next->tid);
+
   /* Mark us as running. */
   next->status = THREAD_RUNNING;
+  next->cpu = curr->cpu;
+  next->cpu->curr = next;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  next->cpu->thread_ticks = 0;
+
+  if (curr != next)
+    account_switch (curr, next);
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -696,60 +1300,143 @@ allocate_tid (void) {
 현재 Thread의 waitLock 이 NULL이면 돌면 안됨
 연결된게 없으니깐
 NULL이 아니면
-순회하면서 priority를 추가
+waitLock의 max_pri를 올리고 lock holder에게 priority를 전달함
 */
 void
 dona_priority (void) {
   struct thread *cur = thread_current ();
+  struct lock *lock = cur->waitLock;
+  enum intr_level old_level = intr_disable ();
 
-  for (int i = 0; i < 8; i++) {
-    if (cur->waitLock == NULL)
-      break;
-    struct thread *hold = cur->waitLock->holder;
-    hold->priority = cur->priority;
-    cur = hold;
+  if (lock != NULL && lock->max_pri < cur->priority) {
+    lock->max_pri = cur->priority;
+    thread_donate (lock->holder, cur->priority);
   }
+  intr_set_level (old_level);
 }
 
-/*
-현재 Thread에서
-Donation안에 있는 list를 순회함
-이때 Donation list 안에 있는 temp thread가 가진 waitLock이
-
-remove 로 요청된 lock과 동일하면
-donation list에서 해당 dona_elem을 지움
-*/
+/* Raises T's priority to PRIORITY, if that is higher, and passes
+   the donation on along the chain of locks T is waiting for,
+   however long.  Stops at the first hop that already has at
+   least PRIORITY, since the rest of the chain then has it too.
+   Also used by rwlock_acquire_write() to donate to readers,
+   which do not appear as a lock holder.  Interrupts must be
+   off. */
 void
-remove_lock (struct lock *lock) {
-  struct thread *cur = thread_current ();
-  struct thread *temp;
-  struct list_elem *temp_e;
-
-  for (temp_e = list_begin (&cur->dona); list_end (&cur->dona) != temp_e;
-       temp_e = list_next (temp_e)) {
-    temp = list_entry (temp_e, struct thread, dona_elem);
-    if (temp->waitLock == lock)
-      list_remove (&temp->dona_elem);
+thread_donate (struct thread *t, int priority) {
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (t != NULL && t->priority < priority) {
+    struct lock *lock = t->waitLock;
+
+    t->priority = priority;
+    thread_requeue (t);
+    if (lock == NULL || lock->max_pri >= priority)
+      break;
+    lock->max_pri = priority;
+    t = lock->holder;
   }
 }
 
 /*
 현재 Thread priority에 해당 Thread의 초기 priority를 넣어줌 (즉, 초기화를
-시켜줌) 현재 Thread의 우선순위와 현재 Thread가 받은 dona 의 우선순위를 비교하여
+시켜줌) 현재 Thread의 우선순위와 현재 Thread가 가진 lock들의 max_pri를 비교하여
 더 큰 우선 순위를 적용한다
 */
 void
 refresh_pri (void) {
   struct thread *cur = thread_current ();
-  int temp;
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+
   cur->priority = cur->init_pri;
-  if (!list_empty (&cur->dona))
-    list_sort (&cur->dona, compare_priority, NULL);
-
-  if (!list_empty (&cur->dona)) {
-    temp = list_entry (list_begin (&cur->dona), struct thread, dona_elem)
-               ->priority;
-    if (cur->priority < temp)
-      cur->priority = temp;
+  for (e = list_begin (&cur->held_locks); e != list_end (&cur->held_locks);
+       e = list_next (e)) {
+    struct lock *lock = list_entry (e, struct lock, held_elem);
+    if (cur->priority < lock->max_pri)
+      cur->priority = lock->max_pri;
+  }
+
+  /* A writer waiting for us to stop reading donates, too. */
+  for (int i = 0; i < RWLOCK_NEST_MAX; i++) {
+    struct rwlock *rw = cur->rd_holds[i].rwlock;
+    if (rw != NULL && rw->drainer != NULL
+        && cur->priority < rw->drainer->priority)
+      cur->priority = rw->drainer->priority;
   }
-}
\ No newline at end of file
+  intr_set_level (old_level);
+}
+
+/* Returns every page held by the thread page cache to the page
+   allocator, and returns the number of pages freed.  Called by
+   palloc when it runs out of kernel pages. */
+size_t
+thread_cache_reclaim (void) {
+  return page_cache_drain (&thread_page_cache);
+}
+
+/* Makes the thread page cache keep at most MAX freed pages.  0
+   turns the cache off, so that its effect can be measured. */
+void
+thread_cache_set_max (int max) {
+  ASSERT (max >= 0);
+  thread_page_cache.max = max;
+}
+
+/* Returns a block of CACHE->page_cnt pages from CACHE, or from
+   palloc with the given FLAGS if CACHE is empty.  Blocks from the
+   cache are returned as they were freed, whatever FLAGS says. */
+static void *
+page_cache_get (struct page_cache *cache, enum palloc_flags flags) {
+  enum intr_level old_level = intr_disable ();
+  void **block = cache->free;
+
+  if (block != NULL) {
+    cache->free = *block;
+    cache->cnt--;
+    cache->hits++;
+  } else
+    cache->misses++;
+  intr_set_level (old_level);
+
+  if (block == NULL)
+    block = palloc_get_multiple (flags, cache->page_cnt);
+  return block;
+}
+
+/* Adds BLOCK to CACHE, or frees it if CACHE is full.  Interrupts
+   must be off. */
+static void
+page_cache_put (struct page_cache *cache, void *block) {
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cache->cnt < cache->max) {
+    *(void **) block = cache->free;
+    cache->free = block;
+    cache->cnt++;
+  } else
+    palloc_free_multiple (block, cache->page_cnt);
+}
+
+/* Frees every block in CACHE and returns the number of pages
+   freed. */
+static size_t
+page_cache_drain (struct page_cache *cache) {
+  enum intr_level old_level;
+  void *free;
+  size_t page_cnt = 0;
+
+  old_level = intr_disable ();
+  free = cache->free;
+  cache->free = NULL;
+  cache->cnt = 0;
+  intr_set_level (old_level);
+
+  while (free != NULL) {
+    void *next = *(void **) free;
+    palloc_free_multiple (free, cache->page_cnt);
+    page_cnt += cache->page_cnt;
+    free = next;
+  }
+  return page_cnt;
+}
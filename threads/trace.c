@@ -0,0 +1,103 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef FILESYS
+#include "filesys/fsutil.h"
+#endif
+
+/* Set by kernel command-line option "-trace". */
+bool trace_enabled;
+
+/* The trace dump, laid out exactly as it is written out: a
+   header followed by one ring buffer per possible CPU.  NULL
+   while not recording. */
+static struct trace_header *header;
+static struct trace_cpu *buffers;
+
+/* Size in bytes of a dump of CPU_CNT CPUs. */
+#define DUMP_SIZE(CPU_CNT) \
+	(sizeof (struct trace_header) + (CPU_CNT) * sizeof (struct trace_cpu))
+
+/* Starts recording, if "-trace" was given.  Must be called after
+   palloc_init() and timer_init(). */
+void
+trace_init (void) {
+	size_t page_cnt = DIV_ROUND_UP (DUMP_SIZE (CPU_MAX), PGSIZE);
+
+	if (!trace_enabled)
+		return;
+
+	header = palloc_get_multiple (PAL_ZERO, page_cnt);
+	if (header == NULL) {
+		printf ("trace: could not allocate %zu pages, not tracing\n", page_cnt);
+		return;
+	}
+	memcpy (header->magic, "PTRACE1", 8);
+	header->events_per_cpu = TRACE_EVENTS;
+	header->timer_freq = TIMER_FREQ;
+	header->start_tsc = rdtsc ();
+	header->start_ticks = timer_ticks ();
+	buffers = (struct trace_cpu *) (header + 1);
+}
+
+/* Records an event of the given TYPE with arguments ARG0 and
+   ARG1 in the running CPU's ring buffer.  May be called from
+   any context, including interrupt handlers. */
+void
+trace_record (enum trace_type type, uint64_t arg0, uint64_t arg1) {
+	enum intr_level old_level;
+	struct trace_cpu *tc;
+	struct trace_event *e;
+	struct cpu *c;
+
+	if (buffers == NULL)
+		return;
+
+	old_level = intr_disable ();
+	if (buffers != NULL) {
+		c = this_cpu ();
+		tc = &buffers[c->id];
+		e = &tc->events[tc->written++ % TRACE_EVENTS];
+		e->tsc = rdtsc ();
+		e->type = type;
+		e->tid = c->curr != NULL ? c->curr->tid : 0;
+		e->arg0 = arg0;
+		e->arg1 = arg1;
+	}
+	intr_set_level (old_level);
+}
+
+/* Stops recording and writes the trace to the scratch disk,
+   where "pintos --trace FILE" expects it: after the files that
+   "get" actions copied there.  Does nothing if not recording.
+   Called by power_off(). */
+void
+trace_dump (void) {
+	if (buffers == NULL)
+		return;
+	buffers = NULL;
+
+	header->cpu_cnt = cpu_cnt;
+	header->end_tsc = rdtsc ();
+	header->end_ticks = timer_ticks ();
+
+#ifdef FILESYS
+	/* Writing to disk needs interrupts, so there is nothing we can
+	   do when powering off from a panic with interrupts off. */
+	if (intr_context () || intr_get_level () == INTR_OFF)
+		printf ("trace: interrupts off, trace not written\n");
+	else if (fsutil_get_buffer ("trace", header, DUMP_SIZE (cpu_cnt)))
+		printf ("trace: wrote %d CPUs' events to scratch disk\n", cpu_cnt);
+#else
+	printf ("trace: no scratch disk without FILESYS, trace not written\n");
+#endif
+}
@@ -0,0 +1,85 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func worker;
+
+/* Initializes W to call FUNC with AUX once run. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	w->func = func;
+	w->aux = aux;
+	w->pending = false;
+}
+
+/* Starts a worker thread for each online CPU.  Work queued
+   earlier runs as soon as its worker starts.  Must be called
+   after thread_start(). */
+void
+workqueue_init (void) {
+	int i;
+
+	for (i = 0; i < cpu_cnt; i++) {
+		char name[sizeof "kworker/-2147483648"];
+
+		snprintf (name, sizeof name, "kworker/%d", i);
+		if (thread_create (name, PRI_MAX, worker, &cpus[i]) == TID_ERROR)
+			PANIC ("workqueue: could not start %s", name);
+	}
+}
+
+/* Queues W on the running CPU's worker thread, which calls it in
+   thread context, after any work queued before it.  Returns
+   false, doing nothing, if W is already queued.  May be called
+   from any context, including interrupt handlers, but W must
+   only be queued from one CPU at a time. */
+bool
+work_queue (struct work *w) {
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = this_cpu ();
+	bool queued = !w->pending;
+
+	if (queued) {
+		w->pending = true;
+		spinlock_acquire (&c->work_lock);
+		list_push_back (&c->work, &w->elem);
+		spinlock_release (&c->work_lock);
+		sema_up (&c->work_ready);
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Worker thread for CPU C_: runs the work queued on C_, in
+   order, sleeping while there is none.  Runs in SCHED_FIFO, so
+   that deferred interrupt work waits for no CPU-bound thread,
+   however high its priority and however long it runs. */
+static void
+worker (void *c_) {
+	struct cpu *c = c_;
+	struct sched_attr attr = { .sched_class = SCHED_FIFO,
+	                           .priority = SCHED_FIFO_PRI_MAX };
+
+	if (!thread_set_sched (&attr))
+		PANIC ("workqueue: could not make %s SCHED_FIFO", thread_name ());
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *w;
+
+		sema_down (&c->work_ready);
+
+		old_level = intr_disable ();
+		spinlock_acquire (&c->work_lock);
+		w = list_entry (list_pop_front (&c->work), struct work, elem);
+		w->pending = false;
+		spinlock_release (&c->work_lock);
+		intr_set_level (old_level);
+
+		w->func (w->aux);
+	}
+}
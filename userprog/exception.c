@@ -4,7 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
+#include "userprog/process.h"
 #include "userprog/syscall.h"
 
 /* Number of page faults processed. */
@@ -127,6 +130,7 @@ page_fault (struct intr_frame *f) {
      that caused the fault (that's f->rip). */
 
   fault_addr = (void *) rcr2 ();
+  trace_record (TRACE_PAGE_FAULT, (uint64_t) fault_addr, f->error_code);
 
   /* Turn interrupts back on (they were only off so that we could
      be assured of reading CR2 before it changed). */
@@ -137,17 +141,37 @@ page_fault (struct intr_frame *f) {
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  if (user) {
-    f->R.rdi = -1;
-    exit_handler (f->R.rdi);
-  }
-
 #ifdef VM
   /* For project 3 and later. */
   if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
     return;
+#else
+  /* A first touch of a page of the executable, or a write to a page
+     that fork() left shared, by the user or by a system call on its
+     behalf. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && process_load_page (fault_addr))
+    return;
+  /* The stack growing.  In a system call, the user stack pointer is
+     the one saved on entry. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && process_stack_access (fault_addr, user ? f->rsp
+                                                : thread_current ()->user_rsp)
+      && process_grow_stack (fault_addr))
+    return;
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && process_handle_cow (fault_addr))
+    return;
 #endif
 
+  /* A bad access by the user ends the process.  So does a system
+     call's write to a read-only user page, which faults only since
+     CR0.WP makes the kernel honor read-only pages too. */
+  if (user || (!not_present && write && is_user_vaddr (fault_addr))) {
+    f->R.rdi = -1;
+    exit_handler (f->R.rdi);
+  }
+
   /* Count page faults. */
   page_fault_cnt++;
 
@@ -0,0 +1,188 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "userprog/syscall.h"
+
+/* Initial number of slots in a file descriptor table. */
+#define FD_TABLE_MIN 16
+
+#define BITS_PER_WORD 64
+#define WORD_CNT(CAP) (((CAP) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+
+static bool fd_table_init (struct fd_table *, int cap);
+static bool fd_table_grow (struct fd_table *);
+
+/* Creates and returns a file descriptor table with only the
+   console descriptors 0 and 1 in use, or a null pointer if
+   memory is exhausted. */
+struct fd_table *
+fd_table_create (void) {
+  struct fd_table *fdt = malloc (sizeof *fdt);
+
+  if (fdt == NULL)
+    return NULL;
+  if (!fd_table_init (fdt, FD_TABLE_MIN)) {
+    free (fdt);
+    return NULL;
+  }
+  fdt->files[0] = FD_STDIN_MARKER;
+  fdt->files[1] = FD_STDOUT_MARKER;
+  fdt->used[0] = 0x3;
+  fdt->first_free = 2;
+  return fdt;
+}
+
+/* Returns a copy of PARENT for a forked child, with each open
+   file duplicated, or a null pointer if memory is exhausted.
+   PARENT is locked meanwhile, since the parent's other threads
+   may be opening and closing files. */
+struct fd_table *
+fd_table_duplicate (struct fd_table *parent) {
+  struct fd_table *fdt = malloc (sizeof *fdt);
+
+  if (fdt == NULL)
+    return NULL;
+  lock_acquire (&parent->lock);
+  if (!fd_table_init (fdt, parent->cap)) {
+    lock_release (&parent->lock);
+    free (fdt);
+    return NULL;
+  }
+  memcpy (fdt->used, parent->used, WORD_CNT (parent->cap) * sizeof *fdt->used);
+  fdt->first_free = parent->first_free;
+
+  for (int fd = 0; fd < parent->cap; fd++) {
+    struct file *file = parent->files[fd];
+    if (fd < 2 || file == NULL)
+      fdt->files[fd] = file;
+    else if ((fdt->files[fd] = file_duplicate (file)) == NULL) {
+      lock_release (&parent->lock);
+      fdt->used[fd / BITS_PER_WORD] &= ~(1ULL << (fd % BITS_PER_WORD));
+      fd_table_destroy (fdt);
+      return NULL;
+    }
+  }
+  lock_release (&parent->lock);
+  return fdt;
+}
+
+/* Closes every file open in FDT and frees it.  Only the last
+   thread of the process calls this, so FDT is not locked. */
+void
+fd_table_destroy (struct fd_table *fdt) {
+  for (int fd = 2; fd < fdt->cap; fd++)
+    if (fdt->files[fd] != NULL) {
+      lock_acquire (&filesys_lock);
+      file_close (fdt->files[fd]);
+      lock_release (&filesys_lock);
+    }
+  free (fdt->files);
+  free (fdt->used);
+  free (fdt);
+}
+
+/* Installs FILE in FDT under the lowest free descriptor, growing
+   FDT if it is full, and returns the descriptor.  Returns -1 if
+   FDT already holds FD_COUNT_LIMT descriptors or memory is
+   exhausted. */
+int
+fd_table_add (struct fd_table *fdt, struct file *file) {
+  int fd = -1;
+
+  ASSERT (file != NULL);
+  ASSERT (lock_held_by_current_thread (&fdt->lock));
+
+  for (int w = fdt->first_free / BITS_PER_WORD; w < WORD_CNT (fdt->cap); w++)
+    if (~fdt->used[w] != 0) {
+      fd = w * BITS_PER_WORD + __builtin_ctzll (~fdt->used[w]);
+      break;
+    }
+  if (fd < 0 || fd >= fdt->cap) {
+    fd = fdt->cap;
+    if (!fd_table_grow (fdt))
+      return -1;
+  }
+
+  fdt->files[fd] = file;
+  fdt->used[fd / BITS_PER_WORD] |= 1ULL << (fd % BITS_PER_WORD);
+  fdt->first_free = fd + 1;
+  return fd;
+}
+
+/* Returns the file open as FD in FDT, or a null pointer if FD is
+   not open.  Descriptors 0 and 1 return their console markers. */
+struct file *
+fd_table_get (struct fd_table *fdt, int fd) {
+  ASSERT (lock_held_by_current_thread (&fdt->lock));
+
+  if (fd < 0 || fd >= fdt->cap)
+    return NULL;
+  return fdt->files[fd];
+}
+
+/* Removes FD from FDT and returns the file that was open as FD,
+   or a null pointer if FD was not open.  The file is not
+   closed. */
+struct file *
+fd_table_remove (struct fd_table *fdt, int fd) {
+  struct file *file = fd_table_get (fdt, fd);
+
+  if (file != NULL) {
+    fdt->files[fd] = NULL;
+    fdt->used[fd / BITS_PER_WORD] &= ~(1ULL << (fd % BITS_PER_WORD));
+    if (fd < fdt->first_free)
+      fdt->first_free = fd;
+  }
+  return file;
+}
+
+/* Initializes FDT with CAP empty slots.  Returns false if memory
+   is exhausted. */
+static bool
+fd_table_init (struct fd_table *fdt, int cap) {
+  fdt->files = calloc (cap, sizeof *fdt->files);
+  fdt->used = calloc (WORD_CNT (cap), sizeof *fdt->used);
+  if (fdt->files == NULL || fdt->used == NULL) {
+    free (fdt->files);
+    free (fdt->used);
+    return false;
+  }
+  fdt->cap = cap;
+  fdt->first_free = 0;
+  lock_init (&fdt->lock);
+  return true;
+}
+
+/* Doubles the capacity of FDT.  Returns false if FDT is already
+   at FD_COUNT_LIMT or memory is exhausted, leaving FDT
+   unchanged. */
+static bool
+fd_table_grow (struct fd_table *fdt) {
+  int cap = fdt->cap * 2;
+  struct file **files;
+  uint64_t *used;
+
+  if (cap > FD_COUNT_LIMT)
+    return false;
+
+  files = realloc (fdt->files, cap * sizeof *files);
+  if (files == NULL)
+    return false;
+  fdt->files = files;
+  memset (files + fdt->cap, 0, (cap - fdt->cap) * sizeof *files);
+
+  if (WORD_CNT (cap) > WORD_CNT (fdt->cap)) {
+    used = realloc (fdt->used, WORD_CNT (cap) * sizeof *used);
+    if (used == NULL)
+      return false;
+    fdt->used = used;
+    memset (used + WORD_CNT (fdt->cap), 0,
+            (WORD_CNT (cap) - WORD_CNT (fdt->cap)) * sizeof *used);
+  }
+
+  fdt->cap = cap;
+  return true;
+}
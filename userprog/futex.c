@@ -0,0 +1,182 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "userprog/uthread.h"
+
+/* Number of wait queues.  A power of 2. */
+#define FUTEX_BUCKETS 64
+
+/* A wait queue, shared by every futex whose address hashes here. */
+struct futex_bucket {
+  struct lock lock;             /* Protects `waiters'. */
+  struct list waiters;          /* struct futex_waiters, by priority. */
+};
+
+/* What a futex is known by: the address space and the user
+   address of its word.  Unlike the word's physical address, this
+   stays put while the page is swapped out or copied on write.  No
+   memory is shared between processes in this kernel, so no word
+   is known by two keys. */
+struct futex_key {
+  uint64_t *pml4;               /* Page table of the process. */
+  uintptr_t uaddr;              /* User address of the word. */
+};
+
+/* A thread blocked in futex_wait().  Lives on its stack. */
+struct futex_waiter {
+  struct list_elem elem;        /* In its bucket's `waiters'. */
+  struct futex_key key;         /* Word waited on. */
+  struct thread *thread;        /* The waiting thread. */
+  int priority;                 /* Waiter's priority when it began. */
+  struct semaphore wakeup;      /* Upped by futex_wake(). */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+static bool futex_lookup (uint32_t *uaddr, struct futex_key *key);
+static bool waiter_more (const struct list_elem *,
+                         const struct list_elem *, void *aux);
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) {
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++) {
+    lock_init (&buckets[i].lock);
+    list_init (&buckets[i].waiters);
+  }
+}
+
+/* Returns the bucket for KEY. */
+static struct futex_bucket *
+bucket_of (const struct futex_key *key) {
+  return &buckets[hash_bytes (key, sizeof *key) & (FUTEX_BUCKETS - 1)];
+}
+
+/* Returns true if keys A and B name the same word. */
+static bool
+key_equal (const struct futex_key *a, const struct futex_key *b) {
+  return a->pml4 == b->pml4 && a->uaddr == b->uaddr;
+}
+
+/* If the word at user address UADDR still holds EXPECTED, sleeps
+   until a futex_wake() on the same word wakes us, and returns 0.
+   Otherwise returns -1 at once.  The check and going to sleep are
+   atomic with respect to futex_wake(), so a waker that changes
+   the word and then wakes it cannot be missed.  Also returns -1
+   if UADDR is not 4-byte aligned or the process is exiting, and
+   kills the process if UADDR is not mapped. */
+int
+futex_wait (uint32_t *uaddr, uint32_t expected) {
+  struct futex_waiter w;
+  struct futex_bucket *b;
+
+  if (!futex_lookup (uaddr, &w.key))
+    return -1;
+
+  /* The word is read through its user address, with the bucket
+     locked.  Should its page have been evicted or copied on write
+     since futex_lookup() checked it, the read faults it back in
+     like any other access a system call makes. */
+  b = bucket_of (&w.key);
+  lock_acquire (&b->lock);
+  if (*(volatile uint32_t *) uaddr != expected || uthread_exiting ()) {
+    lock_release (&b->lock);
+    return -1;
+  }
+  w.thread = thread_current ();
+  w.priority = thread_get_priority ();
+  sema_init (&w.wakeup, 0);
+  list_insert_ordered (&b->waiters, &w.elem, waiter_more, NULL);
+  lock_release (&b->lock);
+
+  sema_down (&w.wakeup);
+  return 0;
+}
+
+/* Wakes up to CNT threads waiting on the word at user address
+   UADDR, highest priority first, and returns the number woken.
+   Returns -1 if UADDR is not 4-byte aligned, and kills the
+   process if it is not mapped. */
+int
+futex_wake (uint32_t *uaddr, int cnt) {
+  struct futex_bucket *b;
+  struct list_elem *e;
+  struct futex_key key;
+  int woken = 0;
+
+  if (!futex_lookup (uaddr, &key))
+    return -1;
+
+  b = bucket_of (&key);
+  lock_acquire (&b->lock);
+  for (e = list_begin (&b->waiters);
+       e != list_end (&b->waiters) && woken < cnt; ) {
+    struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+    e = list_next (e);
+    if (key_equal (&w->key, &key)) {
+      list_remove (&w->elem);
+      sema_up (&w->wakeup);
+      woken++;
+    }
+  }
+  lock_release (&b->lock);
+  return woken;
+}
+
+/* Wakes every thread of the process with thread group G that
+   sleeps in futex_wait(), whatever word it waits on.  Called
+   once the process is exiting, after which futex_wait() no longer
+   sleeps in it. */
+void
+futex_wake_group (const struct uthread_group *g) {
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++) {
+    struct futex_bucket *b = &buckets[i];
+    struct list_elem *e;
+
+    lock_acquire (&b->lock);
+    for (e = list_begin (&b->waiters); e != list_end (&b->waiters); ) {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+      e = list_next (e);
+      if (w->thread->group == g) {
+        list_remove (&w->elem);
+        sema_up (&w->wakeup);
+      }
+    }
+    lock_release (&b->lock);
+  }
+}
+
+/* Stores the key of the user word at UADDR in *KEY, and returns
+   true.  Returns false if UADDR is misaligned.  Kills the process
+   if UADDR is not a valid user address. */
+static bool
+futex_lookup (uint32_t *uaddr, struct futex_key *key) {
+  if ((uintptr_t) uaddr % sizeof *uaddr != 0)
+    return false;
+  check_address (uaddr);
+  key->pml4 = thread_current ()->pml4;
+  key->uaddr = (uintptr_t) uaddr;
+  return true;
+}
+
+/* Orders futex waiters by descending priority, and waiters of
+   equal priority first come, first served. */
+static bool
+waiter_more (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED) {
+  const struct futex_waiter *a = list_entry (a_, struct futex_waiter, elem);
+  const struct futex_waiter *b = list_entry (b_, struct futex_waiter, elem);
+
+  return a->priority > b->priority;
+}
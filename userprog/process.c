@@ -10,15 +10,19 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
+#include "userprog/fdtable.h"
 #include "userprog/syscall.h"
+#include "userprog/uthread.h"
 #include "kernel/list.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -29,6 +33,33 @@ static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
 
+#ifndef VM
+/* Serializes the page faults handled here, so that two threads of
+   one process faulting on the same page cannot both fill it. */
+static struct lock page_lock;
+
+/* Most PT_LOAD segments an executable may have. */
+#define IMAGE_SEGMENTS 16
+
+/* A PT_LOAD segment, loaded a page at a time as the process first
+   touches it. */
+struct segment {
+  uintptr_t start, end;   /* Page-aligned range of user addresses. */
+  off_t ofs;              /* File offset of START. */
+  size_t read_bytes;      /* Bytes read from the file from START on;
+                             the rest of the segment is zeros. */
+  bool writable;          /* Mapped writable? */
+};
+
+/* The executable a process runs.  Shared by the threads of the
+   process; fork() gives the child a copy. */
+struct image {
+  struct file *file;      /* Also the thread's `running' file. */
+  size_t segment_cnt;
+  struct segment segments[IMAGE_SEGMENTS];
+};
+#endif
+
 struct argv {
   struct thread *fork_thread;
   struct intr_frame *fork_if;
@@ -39,6 +70,40 @@ static void process_init (void) {
   struct thread *current = thread_current ();
 }
 
+/* Returns true if a fault at user address ADDR, taken with the user
+   stack pointer at RSP, is the running thread's stack growing:
+   ADDR is at most 8 bytes below RSP, where PUSH writes, and within
+   the thread's stack limit below USER_STACK.  Overflowing the limit
+   hits the unmapped guard page below it and fails here. */
+bool
+process_stack_access (const void *addr, uintptr_t rsp) {
+  uintptr_t a = (uintptr_t) addr;
+  size_t limit = thread_current ()->stack_limit;
+
+  return a + 8 >= rsp && a < USER_STACK && a >= USER_STACK - limit;
+}
+
+/* Returns true if the running process may write to the user page
+   that contains ADDR, which must be mapped: the page is writable,
+   or fork() left it shared copy-on-write. */
+bool
+process_page_writable (const void *addr) {
+#ifdef VM
+  struct supplemental_page_table *spt = thread_current ()->spt;
+  bool acquired = spt_acquire_read (spt);
+  struct page *page = spt_find_page (spt, (void *) addr);
+  bool writable = page != NULL && page->writable;
+
+  spt_release_read (spt, acquired);
+  return writable;
+#else
+  uint64_t *pte = pml4e_walk (thread_current ()->pml4,
+                              (uint64_t) pg_round_down (addr), false);
+
+  return pte != NULL && (*pte & (PTE_W | PTE_COW)) != 0;
+#endif
+}
+
 struct thread * get_child (int pid) {
   struct thread *cur = thread_current ();
   struct list *child_list = &cur->child_s;
@@ -62,6 +127,10 @@ struct thread * get_child (int pid) {
 tid_t process_create_initd (const char *file_name) {
   char *fn_copy;
   tid_t tid;
+
+#ifndef VM
+  lock_init (&page_lock);
+#endif
   /* Make a copy of FILE_NAME.
    * Otherwise there's a race between the caller and load(). */
   fn_copy = palloc_get_page (0);
@@ -87,11 +156,19 @@ tid_t process_create_initd (const char *file_name) {
 /* A thread function that launches first user process. */
 static void initd (void *f_name) {
 #ifdef VM
-  supplemental_page_table_init (&thread_current ()->spt);
+  thread_current ()->spt = malloc (sizeof *thread_current ()->spt);
+  if (thread_current ()->spt == NULL)
+    PANIC ("Fail to launch initd\n");
+  supplemental_page_table_init (thread_current ()->spt);
 #endif
+  thread_current ()->stack_limit = STACK_LIMIT_DEFAULT;
 
   process_init ();
 
+  thread_current ()->fd_table = fd_table_create ();
+  if (thread_current ()->fd_table == NULL)
+    PANIC ("Fail to launch initd\n");
+
   if (process_exec (f_name) < 0)
     PANIC ("Fail to launch initd\n");
 
@@ -121,18 +198,23 @@ tid_t process_fork (const char *name, struct intr_frame *if_) {
 
 #ifndef VM
 /* Duplicate the parent's address space by passing this function to the
- * pml4_for_each. This is only for the project 2. */
+ * pml4_for_each. This is only for the project 2.
+ * Pages are shared with the parent rather than copied, so fork()
+ * takes time in proportion to the page tables, not to the memory
+ * they map.  A writable page becomes read-only and copy-on-write
+ * in both processes; whichever writes to it first gets its own
+ * copy then, in process_handle_cow(). */
 static bool
 duplicate_pte (uint64_t *pte, void *va, void *aux) {
   struct thread *current = thread_current ();
   struct argv *argv_fork = (struct argv *) aux;
-  // struct thread *parent = (struct thread *) aux;
   struct thread *parent = argv_fork->fork_thread;
   void *parent_page;
-  void *newpage;
-  bool writable;
+  uint64_t *child_pte;
+
+  ASSERT (lock_held_by_current_thread (&page_lock));
 
-  /* 1. TODO: If the parent_page is kernel page, then return immediately. */
+  /* 1. If the parent_page is kernel page, then return immediately. */
   if (is_kernel_vaddr (va))
     return true;
   /* 2. Resolve VA from the parent's page map level 4. */
@@ -140,27 +222,180 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
   if (parent_page == NULL)
     return false;
 
-  /* 3. TODO: Allocate new PAL_USER page for the child and set result to
-   *    TODO: NEWPAGE. */
-  newpage = palloc_get_page (PAL_USER);
-  if (newpage == NULL) {
-    printf ("duplicate_pte page fault\n");
+  /* 3. Write-protect the parent's page, if writable.  The child's
+   *    page table is active, so the parent's stale TLB entries are
+   *    flushed by the time it runs again. */
+  if (is_writable (pte))
+    *pte = (*pte & ~PTE_W) | PTE_COW;
+
+  /* 4. Map the same page in the child, with the same permissions. */
+  child_pte = pml4e_walk (current->pml4, (uint64_t) va, true);
+  if (child_pte == NULL)
     return false;
-  }
+  palloc_share_page (parent_page);
+  *child_pte = *pte & ~(PTE_A | PTE_D);
+  return true;
+}
+
+/* Handles a write fault at user address VA in the running
+   process, if VA is on a copy-on-write page, by giving the
+   process its own writable copy of the page, or by just making
+   the page writable if no other process shares it any more.
+   Returns true if successful, false if VA is not on a
+   copy-on-write page or memory is exhausted. */
+bool
+process_handle_cow (void *va) {
+  uint64_t *pml4 = thread_current ()->pml4;
+  void *upage = pg_round_down (va);
+  uint64_t *pte;
+  bool success = false;
+
+  lock_acquire (&page_lock);
+  pte = pml4e_walk (pml4, (uint64_t) upage, false);
+  if (pte != NULL && (*pte & PTE_P) && (*pte & PTE_COW))
+    {
+      void *kpage = ptov (PTE_ADDR (*pte));
+
+      success = true;
+      if (palloc_page_shared (kpage))
+        {
+          void *newpage = palloc_get_page (PAL_USER);
+
+          if (newpage != NULL)
+            {
+              memcpy (newpage, kpage, PGSIZE);
+              *pte = vtop (newpage) | (*pte & PTE_FLAGS);
+              palloc_free_page (kpage);
+            }
+          else
+            success = false;
+        }
+      if (success)
+        {
+          *pte = (*pte & ~PTE_COW) | PTE_W;
+          invlpg ((uint64_t) upage);
+        }
+    }
+  lock_release (&page_lock);
+  return success;
+}
 
-  /* 4. TODO: Duplicate parent's page to the new page and
-   *    TODO: check whether parent's page is writable or not (set WRITABLE
-   *    TODO: according to the result). */
-  memcpy (newpage, parent_page, PGSIZE);
-  writable = is_writable (pte);
-
-  /* 5. Add new page to child's page table at address VA with WRITABLE
-   *    permission. */
-  if (!pml4_set_page (current->pml4, va, newpage, writable)) {
-    /* 6. TODO: if fail to insert page, do error handling. */
-    printf (" duplicate_pte pmlt_set_page fault \n");
+/* Handles a fault at user address VA in the running process by
+   loading the page there from the process's executable, if VA
+   lies in one of its segments.  Read-only pages of file data come
+   from the executable's inode, which shares them among all the
+   processes running it.  Returns true if successful or if another
+   thread of the process loaded the page first, false if VA is not
+   in a segment or the page cannot be loaded. */
+bool
+process_load_page (void *va) {
+  struct thread *t = thread_current ();
+  struct image *image = t->image;
+  uintptr_t upage = (uintptr_t) pg_round_down (va);
+  struct segment *seg = NULL;
+  size_t read_bytes, i;
+  off_t ofs;
+  uint8_t *kpage;
+  bool success;
+
+  if (image == NULL)
     return false;
-  }
+  for (i = 0; i < image->segment_cnt && seg == NULL; i++)
+    if (upage >= image->segments[i].start && upage < image->segments[i].end)
+      seg = &image->segments[i];
+  if (seg == NULL)
+    return false;
+
+  ofs = seg->ofs + (upage - seg->start);
+  read_bytes = 0;
+  if (upage - seg->start < seg->read_bytes)
+    read_bytes = seg->read_bytes - (upage - seg->start);
+  if (read_bytes > PGSIZE)
+    read_bytes = PGSIZE;
+
+  lock_acquire (&page_lock);
+  success = pml4_get_page (t->pml4, (void *) upage) != NULL;
+  if (!success)
+    {
+      if (!seg->writable && read_bytes > 0)
+        kpage = inode_get_text_page (file_get_inode (image->file), ofs,
+                                     read_bytes);
+      else
+        {
+          kpage = palloc_get_page (PAL_USER);
+          if (kpage != NULL
+              && file_read_at (image->file, kpage, read_bytes, ofs)
+                 != (off_t) read_bytes)
+            {
+              palloc_free_page (kpage);
+              kpage = NULL;
+            }
+          if (kpage != NULL)
+            memset (kpage + read_bytes, 0, PGSIZE - read_bytes);
+        }
+      if (kpage != NULL)
+        {
+          success = pml4_set_page (t->pml4, (void *) upage, kpage,
+                                   seg->writable);
+          if (!success)
+            palloc_free_page (kpage);
+        }
+    }
+  lock_release (&page_lock);
+  return success;
+}
+
+/* Grows the running process's stack down to user address ADDR,
+   mapping zeroed pages from ADDR's page up to the lowest page of
+   the stack mapped so far all at once, so that a large stack frame
+   costs one fault rather than one per page.  The caller checks
+   process_stack_access() first.  Returns true if successful, false
+   if memory is exhausted. */
+bool
+process_grow_stack (void *addr) {
+  uint64_t *pml4 = thread_current ()->pml4;
+  uint8_t *upage;
+  bool success = true;
+
+  lock_acquire (&page_lock);
+  for (upage = pg_round_down (addr);
+       success && (uintptr_t) upage < USER_STACK
+       && pml4_get_page (pml4, upage) == NULL;
+       upage += PGSIZE)
+    {
+      void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+
+      success = kpage != NULL && pml4_set_page (pml4, upage, kpage, true);
+      if (!success && kpage != NULL)
+        palloc_free_page (kpage);
+    }
+  lock_release (&page_lock);
+  return success;
+}
+
+/* Gives the running process, a child being forked from PARENT,
+   its own copy of PARENT's image, with its own handle on the
+   executable.  Returns true if successful, false if memory is
+   exhausted. */
+static bool
+image_duplicate (struct thread *parent) {
+  struct thread *cur = thread_current ();
+  struct image *image;
+
+  if (parent->image == NULL)
+    return true;
+  image = malloc (sizeof *image);
+  if (image == NULL)
+    return false;
+  memcpy (image, parent->image, sizeof *image);
+  image->file = file_duplicate (parent->image->file);
+  if (image->file == NULL)
+    {
+      free (image);
+      return false;
+    }
+  cur->image = image;
+  cur->running = image->file;
   return true;
 }
 #endif
@@ -184,6 +419,8 @@ static void __do_fork (void *aux) {
   /* 1. Read the cpu context to local stack. */
   memcpy (&if_, parent_if, sizeof (struct intr_frame));
   if_.R.rax = 0;
+  current->stack_limit = parent->uthread == NULL ? parent->stack_limit
+                                                 : STACK_LIMIT_DEFAULT;
 
   /* 2. Duplicate PT */
   current->pml4 = pml4_create ();
@@ -192,11 +429,28 @@ static void __do_fork (void *aux) {
 
   process_activate (current);
 #ifdef VM
-  supplemental_page_table_init (&current->spt);
-  if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+  current->spt = malloc (sizeof *current->spt);
+  if (current->spt == NULL)
+    goto error;
+  supplemental_page_table_init (current->spt);
+  /* The child's own handle keeps the executable from being written
+     while the child runs, and is the one its copies of the parent's
+     text pages load from. */
+  if (parent->running != NULL) {
+    current->running = file_duplicate (parent->running);
+    if (current->running == NULL)
+      goto error;
+  }
+  if (!supplemental_page_table_copy (current->spt, parent->spt))
     goto error;
 #else
-  if (!pml4_for_each (parent->pml4, duplicate_pte, fork_argv))
+  /* page_lock keeps the parent's page tables still while they are
+     copied: a write fault in another of its threads could otherwise
+     take a page that duplicate_pte() is making copy-on-write. */
+  lock_acquire (&page_lock);
+  succ = pml4_for_each (parent->pml4, duplicate_pte, fork_argv);
+  lock_release (&page_lock);
+  if (!succ || !image_duplicate (parent))
     goto error;
 #endif
 
@@ -205,20 +459,10 @@ static void __do_fork (void *aux) {
    * TODO:       in include/filesys/file.h. Note that parent should not return
    * TODO:       from the fork() until this function successfully duplicates
    * TODO:       the resources of parent.*/
-  if (parent->fd_idx >= FD_COUNT_LIMT)
+  current->fd_table = fd_table_duplicate (parent->fd_table);
+  if (current->fd_table == NULL)
     goto error;
 
-  current->fd_table[0] = parent->fd_table[0];
-  current->fd_table[1] = parent->fd_table[1];
-
-  for (int i = 2; i < FD_COUNT_LIMT; i++) {
-    struct file *temp_file = parent->fd_table[i];
-    if (temp_file == NULL)
-      continue;
-    current->fd_table[i] = file_duplicate (temp_file);
-  }
-
-  current->fd_idx = parent->fd_idx;
   sema_up (&current->fork_sema);
 
   // if_.R.rax = 0;
@@ -248,6 +492,9 @@ int process_exec (void *f_name) {
 
   /* We first kill the current context */
   process_cleanup ();
+#ifdef VM
+  supplemental_page_table_init (thread_current ()->spt);
+#endif
 
   /* And then load the binary */
   success = load (file_name, &_if);
@@ -286,12 +533,24 @@ void
 process_exit (void) {
   struct thread *curr = thread_current ();
 
-  for (int i = 2; i < FD_COUNT_LIMT; i++)
-    close_handler (i);
+  /* A thread made by uthread_spawn() leaves the process's
+     resources to its main thread, which waits for it first. */
+  if (curr->uthread != NULL) {
+    uthread_release (curr);
+    return;
+  }
+  uthread_group_exit (curr);
 
-  palloc_free_multiple (curr->fd_table, FD_PAGES);
+  if (curr->fd_table != NULL) {
+    fd_table_destroy (curr->fd_table);
+    curr->fd_table = NULL;
+  }
   file_close(curr->running);
   process_cleanup ();
+#ifdef VM
+  free (curr->spt);
+  curr->spt = NULL;
+#endif
   sema_up (&curr->wait_sema);
   sema_up (&curr->fork_sema);
   sema_down (&curr->exit_sema);
@@ -302,7 +561,11 @@ static void process_cleanup (void) {
   struct thread *curr = thread_current ();
 
 #ifdef VM
-  supplemental_page_table_kill (&curr->spt);
+  if (curr->spt != NULL)
+    supplemental_page_table_kill (curr->spt);
+#else
+  free (curr->image);
+  curr->image = NULL;
 #endif
 
   uint64_t *pml4;
@@ -387,7 +650,9 @@ struct ELF64_PHDR {
 #define ELF  ELF64_hdr
 #define Phdr ELF64_PHDR
 
+#ifndef VM
 static bool setup_stack (struct intr_frame *if_);
+#endif
 static bool validate_segment (const struct Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
@@ -454,6 +719,12 @@ static bool load (const char *file_name, struct intr_frame *if_) {
 
   t->running = file; //현재 실행중인 file을 thread struct에 선언
   file_deny_write(file); //file 접근 권한 제한
+#ifndef VM
+  t->image = calloc (1, sizeof *t->image);
+  if (t->image == NULL)
+    goto done;
+  t->image->file = file;
+#endif
 
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
@@ -624,44 +895,25 @@ static bool install_page (void *upage, void *kpage, bool writable);
  * Return true if successful, false if a memory allocation error
  * or disk read error occurs. */
 static bool
-load_segment (struct file *file, off_t ofs, uint8_t *upage, uint32_t read_bytes,
-              uint32_t zero_bytes, bool writable) {
+load_segment (struct file *file UNUSED, off_t ofs, uint8_t *upage,
+              uint32_t read_bytes, uint32_t zero_bytes, bool writable) {
+  struct image *image = thread_current ()->image;
+  struct segment *seg;
+
   ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
-  file_seek (file, ofs);
-  while (read_bytes > 0 || zero_bytes > 0) {
-    /* Do calculate how to fill this page.
-     * We will read PAGE_READ_BYTES bytes from FILE
-     * and zero the final PAGE_ZERO_BYTES bytes. */
-    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-    size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-    /* Get a page of memory. */
-    uint8_t *kpage = palloc_get_page (PAL_USER);
-    if (kpage == NULL)
-      return false;
-
-    /* Load this page. */
-    if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes) {
-      palloc_free_page (kpage);
-      return false;
-    }
-    memset (kpage + page_read_bytes, 0, page_zero_bytes);
-
-    /* Add the page to the process's address space. */
-    if (!install_page (upage, kpage, writable)) {
-      printf ("fail\n");
-      palloc_free_page (kpage);
-      return false;
-    }
-
-    /* Advance. */
-    read_bytes -= page_read_bytes;
-    zero_bytes -= page_zero_bytes;
-    upage += PGSIZE;
-  }
+  /* Nothing is read now: process_load_page() loads each page when
+   * the process first touches it. */
+  if (image->segment_cnt == IMAGE_SEGMENTS)
+    return false;
+  seg = &image->segments[image->segment_cnt++];
+  seg->start = (uintptr_t) upage;
+  seg->end = (uintptr_t) upage + read_bytes + zero_bytes;
+  seg->ofs = ofs;
+  seg->read_bytes = read_bytes;
+  seg->writable = writable;
   return true;
 }
 
@@ -705,11 +957,16 @@ install_page (void *upage, void *kpage, bool writable) {
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 
+/* Loads a page of a writable segment on its first fault, from
+   AUX, the struct file_page load_segment() gave it.  The file is
+   the process's `running' executable, open as long as the
+   process. */
 static bool
 lazy_load_segment (struct page *page, void *aux) {
-  /* TODO: Load the segment from the file */
-  /* TODO: This called when the first page fault occurs on address VA. */
-  /* TODO: VA is available when calling this function. */
+  bool success = file_page_read (aux, page->frame->kva);
+
+  free (aux);
+  return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -740,13 +997,32 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage, uint32_t read_bytes,
     size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
     size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-    /* TODO: Set up aux to pass information to the lazy_load_segment. */
-    void *aux = NULL;
-    if (!vm_alloc_page_with_initializer (VM_ANON, upage, writable,
-                                         lazy_load_segment, aux))
+    struct file_page *aux = malloc (sizeof *aux);
+    bool success;
+
+    if (aux == NULL)
+      return false;
+    aux->file = file;
+    aux->ofs = ofs;
+    aux->read_bytes = page_read_bytes;
+    /* A read-only page of the file maps the copy of it that every
+       process running this executable shares, as in the non-VM
+       kernel; see vm_do_claim_page().  A writable page, or one of
+       zeros, is private. */
+    aux->text = !writable && page_read_bytes > 0;
+    if (aux->text)
+      success = vm_alloc_page_with_initializer (VM_FILE, upage, false,
+                                                file_lazy_load, aux);
+    else
+      success = vm_alloc_page_with_initializer (VM_ANON, upage, writable,
+                                                lazy_load_segment, aux);
+    if (!success) {
+      free (aux);
       return false;
+    }
 
     /* Advance. */
+    ofs += page_read_bytes;
     read_bytes -= page_read_bytes;
     zero_bytes -= page_zero_bytes;
     upage += PGSIZE;
@@ -755,15 +1031,19 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage, uint32_t read_bytes,
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
-static bool
+bool
 setup_stack (struct intr_frame *if_) {
   bool success = false;
   void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
 
-  /* TODO: Map the stack on stack_bottom and claim the page immediately.
-   * TODO: If success, set the rsp accordingly.
-   * TODO: You should mark the page is stack. */
-  /* TODO: Your code goes here */
+  /* Map the stack on stack_bottom and claim the page immediately.
+   * The page is marked as stack; vm_stack_growth() adds the pages
+   * below it as the stack grows. */
+  if (vm_alloc_page (VM_ANON | VM_MARKER_0, stack_bottom, true)
+      && vm_claim_page (stack_bottom)) {
+    if_->rsp = USER_STACK;
+    success = true;
+  }
 
   return success;
 }
@@ -1,12 +1,16 @@
 #include "userprog/syscall.h"
+#include <round.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/loader.h"
 #include "userprog/gdt.h"
 #include "threads/flags.h"
 #include "threads/init.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 #include "userprog/process.h"
 #include "kernel/stdio.h"
@@ -14,10 +18,16 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "user/syscall.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
+#include "userprog/uthread.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 
+/* Serializes file system calls. */
+struct lock filesys_lock;
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -46,6 +56,7 @@ syscall_init (void) {
              FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
   lock_init (&filesys_lock);
+  futex_init ();
 }
 
 void
@@ -53,6 +64,9 @@ syscall_handler (struct intr_frame *f UNUSED) {
 
   int syscall_no = f->R.rax;
 
+  /* For a stack growth fault taken while handling the call. */
+  thread_current ()->user_rsp = f->rsp;
+
   uint64_t a1 = f->R.rdi;
   uint64_t a2 = f->R.rsi;
   uint64_t a3 = f->R.rdx;
@@ -61,6 +75,8 @@ syscall_handler (struct intr_frame *f UNUSED) {
   uint64_t a6 = f->R.r9;
 
   // SCW_dump_frame (f);
+  trace_record (TRACE_SYSCALL_ENTER, syscall_no, a1);
+  uthread_check_exit ();
   switch (syscall_no) {
   case SYS_HALT:
     halt_handler ();
@@ -104,11 +120,38 @@ syscall_handler (struct intr_frame *f UNUSED) {
   case SYS_CLOSE:
     close_handler (a1);
     break;
+  case SYS_THREAD_STATS:
+    thread_stats_handler ((struct thread_stats *) a1);
+    break;
+  case SYS_FUTEX_WAIT:
+    f->R.rax = futex_wait_handler ((uint32_t *) a1, a2);
+    break;
+  case SYS_FUTEX_WAKE:
+    f->R.rax = futex_wake_handler ((uint32_t *) a1, a2);
+    break;
+  case SYS_UTHREAD_CREATE:
+    f->R.rax = uthread_create_handler ((void *) a1, (void *) a2,
+                                       (void *) a3);
+    break;
+  case SYS_UTHREAD_JOIN:
+    f->R.rax = uthread_join_handler (a1);
+    break;
+  case SYS_UTHREAD_EXIT:
+    uthread_exit_handler (a1);
+    break;
+  case SYS_SCHED_SETATTR:
+    f->R.rax = sched_setattr_handler ((const struct sched_attr *) a1);
+    break;
+  case SYS_SET_STACK_LIMIT:
+    f->R.rax = set_stack_limit_handler (a1);
+    break;
 
   default:
     exit_handler (-1);
     break;
   }
+  trace_record (TRACE_SYSCALL_EXIT, syscall_no, f->R.rax);
+  uthread_check_exit ();
 }
 
 /* 포인터가 가리키는 주소가 user영역에 유요한 주소인지 확인*/
@@ -122,19 +165,64 @@ void
 check_address (void *add) {
   struct thread *cur = thread_current ();
   if (!is_user_vaddr (add) || add == NULL ||
-      pml4_get_page (cur->pml4, add) == NULL) {
+      (pml4_get_page (cur->pml4, add) == NULL
+#ifdef VM
+       && !vm_claim_page (add)
+       && !(process_stack_access (add, cur->user_rsp)
+            && vm_stack_growth (add))
+#else
+       && !process_load_page (add)
+       && !(process_stack_access (add, cur->user_rsp)
+            && process_grow_stack (add))
+#endif
+       )) {
     exit_handler (-1);
   }
 }
 
+/* Checks that the SIZE bytes at BUFFER are all valid user memory,
+   loading each page of them, and, if WRITE is true, that the
+   process may write to them.  Exits the process if not. */
+static void
+check_buffer (const void *buffer, size_t size, bool write) {
+  const uint8_t *end = (const uint8_t *) buffer + size;
+  const uint8_t *p;
+
+  if (size == 0)
+    return;
+  if (end < (const uint8_t *) buffer || !is_user_vaddr (end - 1))
+    exit_handler (-1);
+  for (p = buffer; p < end; p = (const uint8_t *) pg_round_down (p) + PGSIZE) {
+    check_address ((void *) p);
+    if (write && !process_page_writable (p))
+      exit_handler (-1);
+  }
+}
+
+/* Returns the file open as FD in the running process, with the
+   process's descriptor table locked until put_file_using_fd(), so
+   that no other thread closes the file while it is in use.
+   Returns a null pointer, with nothing locked, if FD is not
+   open. */
 static struct file *
 find_file_using_fd (int fd) {
   struct thread *cur = thread_current ();
+  struct file *file;
 
-  if (fd < 0 || fd >= FD_COUNT_LIMT)
+  if (cur->fd_table == NULL)
     return NULL;
 
-  return cur->fd_table[fd];
+  lock_acquire (&cur->fd_table->lock);
+  file = fd_table_get (cur->fd_table, fd);
+  if (file == NULL)
+    lock_release (&cur->fd_table->lock);
+  return file;
+}
+
+/* Unlocks the descriptor table find_file_using_fd() locked. */
+static void
+put_file_using_fd (void) {
+  lock_release (&thread_current ()->fd_table->lock);
 }
 
 void
@@ -145,6 +233,14 @@ halt_handler (void) {
 void
 exit_handler (int status) {
   struct thread *cur = thread_current ();
+
+  /* exit() in any thread ends the process.  Its main thread
+     reports the status once it exits in turn. */
+  if (cur->uthread != NULL) {
+    uthread_exit_process (status);
+    cur->exit_status = status;
+    thread_exit ();
+  }
   cur->exit_status = status;
   printf ("%s: exit(%d)\n", cur->name, status);
   thread_exit ();
@@ -158,6 +254,8 @@ fork_handler (const char *thread_name, struct intr_frame *f) {
 int
 exec_handler (const char *file) {
   check_address (file);
+  if (!uthread_exec_prepare ())
+    return -1;
   char *file_name_copy = palloc_get_page (PAL_ZERO);
 
   if (file_name_copy == NULL)
@@ -210,41 +308,48 @@ open_handler (const char *file) {
 int
 add_file_to_FDT (struct file *file) {
   struct thread *cur = thread_current ();
-  struct file **fdt = cur->fd_table;
-  int fd_index = cur->fd_idx;
+  int fd;
 
-  while (fdt[fd_index] != NULL && fd_index < FD_COUNT_LIMT) {
-    fd_index++;
-  }
-
-  if (fd_index >= FD_COUNT_LIMT) {
+  if (cur->fd_table == NULL)
     return -1;
-  }
 
-  cur->fd_idx = fd_index;
-  fdt[fd_index] = file;
-  return fd_index;
+  lock_acquire (&cur->fd_table->lock);
+  fd = fd_table_add (cur->fd_table, file);
+  lock_release (&cur->fd_table->lock);
+  return fd;
 }
 
 int
 file_size_handler (int fd) {
   struct file *file_ = find_file_using_fd (fd);
+  int size;
 
   if (file_ == NULL)
     return -1;
 
-  return file_length (file_);
+  size = file_length (file_);
+  put_file_using_fd ();
+  return size;
 }
 
+/* File data moves between the file system and the user's buffer
+   through a kernel bounce page, a page at a time, so that the file
+   system never touches user memory.  A fault on a user page may
+   need the disk to load the page, and the disk channel's lock is
+   held while a transfer runs. */
 int
 read_handler (int fd, const void *buffer, unsigned size) {
-  check_address (buffer);
+  check_buffer (buffer, size, true);
   int read_result;
   struct file *file_obj = find_file_using_fd (fd);
 
   if (file_obj == NULL)
     return -1;
 
+  /* The console is no file another thread could close. */
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+    put_file_using_fd ();
+
   if (fd == STDIN_FILENO) {
     char word;
     for (read_result = 0; read_result < size; read_result++) {
@@ -255,17 +360,33 @@ read_handler (int fd, const void *buffer, unsigned size) {
   } else if (fd == STDOUT_FILENO) {
     return -1;
   } else {
-    lock_acquire (&filesys_lock);
-    read_result = file_read (file_obj, buffer, size);
-    lock_release (&filesys_lock);
+    uint8_t *bounce = palloc_get_page (0);
+
+    if (bounce == NULL) {
+      put_file_using_fd ();
+      return -1;
+    }
+    for (read_result = 0; read_result < (int) size; ) {
+      off_t chunk = size - read_result < PGSIZE ? size - read_result : PGSIZE;
+      off_t n;
+
+      lock_acquire (&filesys_lock);
+      n = file_read (file_obj, bounce, chunk);
+      lock_release (&filesys_lock);
+      memcpy ((uint8_t *) buffer + read_result, bounce, n);
+      read_result += n;
+      if (n < chunk)
+        break;
+    }
+    palloc_free_page (bounce);
+    put_file_using_fd ();
   }
   return read_result;
 }
 
 int
 write_handler (int fd, const void *buffer, unsigned size) {
-  check_address (buffer);
-  struct file *file_obj = find_file_using_fd (fd);
+  check_buffer (buffer, size, false);
   if (fd == STDIN_FILENO)
     return 0;
 
@@ -273,11 +394,30 @@ write_handler (int fd, const void *buffer, unsigned size) {
     putbuf (buffer, size);
     return size;
   } else {
+    struct file *file_obj = find_file_using_fd (fd);
     if (file_obj == NULL)
       return 0;
-    lock_acquire (&filesys_lock);
-    off_t write_result = file_write (file_obj, buffer, size);
-    lock_release (&filesys_lock);
+    uint8_t *bounce = palloc_get_page (0);
+    off_t write_result;
+
+    if (bounce == NULL) {
+      put_file_using_fd ();
+      return 0;
+    }
+    for (write_result = 0; write_result < (off_t) size; ) {
+      off_t chunk = size - write_result < PGSIZE ? size - write_result : PGSIZE;
+      off_t n;
+
+      memcpy (bounce, (const uint8_t *) buffer + write_result, chunk);
+      lock_acquire (&filesys_lock);
+      n = file_write (file_obj, bounce, chunk);
+      lock_release (&filesys_lock);
+      write_result += n;
+      if (n < chunk)
+        break;
+    }
+    palloc_free_page (bounce);
+    put_file_using_fd ();
     return write_result;
   }
 }
@@ -286,7 +426,10 @@ void
 seek_handler (int fd, unsigned position) {
   struct file *file_obj = find_file_using_fd (fd);
 
+  if (file_obj == NULL)
+    return;
   file_seek (file_obj, position);
+  put_file_using_fd ();
 }
 
 unsigned
@@ -294,11 +437,14 @@ tell_handler (int fd) {
   if (fd <= 2)
     return;
   struct file *file_obj = find_file_using_fd (fd);
-  check_address (file_obj);
+  unsigned position;
+
   if (file_obj == NULL)
     return;
 
-  return file_tell (file_obj);
+  position = file_tell (file_obj);
+  put_file_using_fd ();
+  return position;
 }
 
 void
@@ -307,12 +453,93 @@ close_handler (int fd) {
   if (file_obj == NULL)
     return;
 
-  if (fd < 0 || fd >= FD_COUNT_LIMT)
+  /* The console descriptors have no file behind them. */
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO) {
+    put_file_using_fd ();
     return;
-  thread_current ()->fd_table[fd] = NULL;
-  palloc_free_page(thread_current ()->fd_table[fd]);
+  }
+  /* No other thread is using the file while the table is locked,
+     and none can find it once it is removed. */
+  fd_table_remove (thread_current ()->fd_table, fd);
+  put_file_using_fd ();
 
   lock_acquire (&filesys_lock);
   file_close (file_obj);
   lock_release (&filesys_lock);
-}
\ No newline at end of file
+}
+
+/* Copies the calling thread's CPU accounting into STATS. */
+void
+thread_stats_handler (struct thread_stats *stats) {
+  check_address (stats);
+  check_address ((char *) stats + sizeof *stats - 1);
+  *stats = thread_current ()->stats;
+}
+
+/* Sleeps until woken by futex_wake if the word at UADDR holds
+   EXPECTED.  See userprog/futex.c. */
+int
+futex_wait_handler (uint32_t *uaddr, uint32_t expected) {
+  return futex_wait (uaddr, expected);
+}
+
+/* Wakes up to CNT threads sleeping on the word at UADDR. */
+int
+futex_wake_handler (uint32_t *uaddr, int cnt) {
+  return futex_wake (uaddr, cnt);
+}
+
+/* Starts a thread in this process at user function ENTRY, which
+   receives FN and ARG.  See userprog/uthread.c. */
+tid_t
+uthread_create_handler (void *entry, void *fn, void *arg) {
+  check_address (entry);
+  return uthread_spawn (entry, fn, arg);
+}
+
+/* Waits for thread TID of this process and returns its status. */
+int
+uthread_join_handler (tid_t tid) {
+  return uthread_wait (tid);
+}
+
+/* Exits the calling thread with STATUS.  In a process's main
+   thread, the same as exit(). */
+void
+uthread_exit_handler (int status) {
+  struct thread *cur = thread_current ();
+
+  if (cur->uthread == NULL)
+    exit_handler (status);
+  cur->exit_status = status;
+  thread_exit ();
+}
+
+/* Moves the calling thread to the scheduling class in *ATTR.
+   Returns 0 if successful, -1 if *ATTR is invalid, asks for a
+   SCHED_FIFO priority above SCHED_FIFO_PRI_USER_MAX, or is
+   refused by admission control. */
+int
+sched_setattr_handler (const struct sched_attr *attr) {
+  check_address ((void *) attr);
+  check_address ((char *) attr + sizeof *attr - 1);
+  if (attr->sched_class == SCHED_FIFO
+      && attr->priority > SCHED_FIFO_PRI_USER_MAX)
+    return -1;
+  return thread_set_sched (attr) ? 0 : -1;
+}
+
+/* Sets how far the calling process's stack may grow below
+   USER_STACK to BYTES, rounded up to a whole number of pages.
+   Pages already mapped stay mapped.  Returns 0 if successful, -1
+   if BYTES is out of range or the caller is a thread made by
+   uthread_create(), whose stack does not grow. */
+int
+set_stack_limit_handler (size_t bytes) {
+  struct thread *cur = thread_current ();
+
+  if (cur->uthread != NULL || bytes < PGSIZE || bytes > STACK_LIMIT_MAX)
+    return -1;
+  cur->stack_limit = ROUND_UP (bytes, PGSIZE);
+  return 0;
+}
@@ -0,0 +1,467 @@
+#include "userprog/uthread.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "threads/flags.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/futex.h"
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Maximum number of threads a process may have running besides
+   its main thread.  Each one gets its own stack slot. */
+#define UTHREAD_MAX 32
+
+/* Stack slot I holds UTHREAD_STACK_PAGES pages of stack, ending
+   at USER_STACK - STACK_LIMIT_MAX - (I + 1) * UTHREAD_STACK_SPAN,
+   with an unmapped guard page below.  The main thread's stack
+   grows down from USER_STACK, at most STACK_LIMIT_MAX bytes. */
+#define UTHREAD_STACK_PAGES 4
+#define UTHREAD_STACK_SPAN ((UTHREAD_STACK_PAGES + 1) * PGSIZE)
+
+/* The threads of one process.  Created by the first
+   uthread_spawn() in the process and freed when its main thread
+   exits or execs. */
+struct uthread_group {
+  struct lock lock;             /* Protects the members below. */
+  struct list threads;          /* struct uthreads not yet joined. */
+  uint32_t stack_slots;         /* Bit I set while slot I is in use. */
+  int live;                     /* # of threads running, main excluded. */
+  bool exiting;                 /* Is the process exiting? */
+  int exit_status;              /* Its exit status, once exiting. */
+  struct semaphore drained;     /* Upped when `live' drops to 0 while
+                                   exiting. */
+  uint64_t *pml4;               /* The process's page table... */
+  struct image *image;          /* ...its executable's segments... */
+#ifdef VM
+  struct supplemental_page_table *spt; /* ...or its pages... */
+#endif
+  struct fd_table *fd_table;    /* ...and file descriptor table. */
+};
+
+/* A thread created by uthread_spawn().  Outlives the thread
+   until it is joined or its process exits. */
+struct uthread {
+  struct list_elem elem;        /* In its group's `threads'. */
+  struct uthread_group *group;  /* Process it belongs to. */
+  tid_t tid;                    /* Thread identifier. */
+  int slot;                     /* Stack slot. */
+  bool joining;                 /* Has a uthread_wait() claimed it? */
+  int status;                   /* Exit status, once `done'. */
+  struct semaphore started;     /* Upped once the creator is done. */
+  struct semaphore done;        /* Upped when the thread exits. */
+  uintptr_t entry, fn, arg;     /* User code to start at. */
+};
+
+static thread_func uthread_start;
+static bool map_stack (struct uthread_group *, int slot);
+static void unmap_stack (struct uthread_group *, int slot);
+
+/* Returns the address just past the top of stack slot SLOT. */
+static uintptr_t
+stack_top (int slot) {
+  return USER_STACK - STACK_LIMIT_MAX
+         - (uintptr_t) (slot + 1) * UTHREAD_STACK_SPAN;
+}
+
+/* Returns the running process's thread group, creating it if
+   needed, or a null pointer if memory is exhausted. */
+static struct uthread_group *
+get_group (void) {
+  struct thread *cur = thread_current ();
+  struct uthread_group *g = cur->group;
+
+  if (g == NULL) {
+    g = malloc (sizeof *g);
+    if (g == NULL)
+      return NULL;
+    lock_init (&g->lock);
+    list_init (&g->threads);
+    g->stack_slots = 0;
+    g->live = 0;
+    g->exiting = false;
+    g->exit_status = 0;
+    sema_init (&g->drained, 0);
+    g->pml4 = cur->pml4;
+    g->image = cur->image;
+#ifdef VM
+    g->spt = cur->spt;
+#endif
+    g->fd_table = cur->fd_table;
+    cur->group = g;
+  }
+  return g;
+}
+
+/* Starts a thread in the running process that calls the user
+   function at ENTRY with FN and ARG as its two arguments, on a
+   fresh stack.  Returns its thread identifier, or TID_ERROR if
+   the process has UTHREAD_MAX threads running already, is
+   exiting, or memory is exhausted. */
+tid_t
+uthread_spawn (void *entry, void *fn, void *arg) {
+  struct uthread_group *g = get_group ();
+  struct uthread *u;
+  struct thread *t;
+  int slot;
+
+  if (g == NULL)
+    return TID_ERROR;
+  u = malloc (sizeof *u);
+  if (u == NULL)
+    return TID_ERROR;
+  u->group = g;
+  u->joining = false;
+  u->status = -1;
+  sema_init (&u->started, 0);
+  sema_init (&u->done, 0);
+  u->entry = (uintptr_t) entry;
+  u->fn = (uintptr_t) fn;
+  u->arg = (uintptr_t) arg;
+
+  lock_acquire (&g->lock);
+  slot = g->stack_slots != UINT32_MAX ? __builtin_ctz (~g->stack_slots) : -1;
+  if (g->exiting || slot < 0 || !map_stack (g, slot)) {
+    lock_release (&g->lock);
+    free (u);
+    return TID_ERROR;
+  }
+  u->slot = slot;
+  g->stack_slots |= 1u << slot;
+  g->live++;
+  lock_release (&g->lock);
+
+  u->tid = thread_create (thread_current ()->name, thread_get_priority (),
+                          uthread_start, u);
+  if (u->tid == TID_ERROR) {
+    lock_acquire (&g->lock);
+    unmap_stack (g, slot);
+    g->stack_slots &= ~(1u << slot);
+    g->live--;
+    lock_release (&g->lock);
+    free (u);
+    return TID_ERROR;
+  }
+
+  /* The new thread waits on `started', so it is still alive: it
+     is a thread of the process, not our child, and it must be
+     joinable before it can exit. */
+  t = get_child (u->tid);
+  list_remove (&t->child_elem);
+  lock_acquire (&g->lock);
+  list_push_back (&g->threads, &u->elem);
+  lock_release (&g->lock);
+  sema_up (&u->started);
+  return u->tid;
+}
+
+/* Thread function for a thread made by uthread_spawn(): adopts
+   its process's address space and files and jumps to user mode. */
+static void
+uthread_start (void *u_) {
+  struct uthread *u = u_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_;
+
+  sema_down (&u->started);
+
+  cur->group = u->group;
+  cur->uthread = u;
+  cur->pml4 = u->group->pml4;
+  cur->image = u->group->image;
+#ifdef VM
+  cur->spt = u->group->spt;
+#endif
+  cur->fd_table = u->group->fd_table;
+  process_activate (cur);
+
+  memset (&if_, 0, sizeof if_);
+  if_.ds = if_.es = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.rip = u->entry;
+  if_.R.rdi = u->fn;
+  if_.R.rsi = u->arg;
+  /* As if ENTRY had been called: the return address slot. */
+  if_.rsp = stack_top (u->slot) - sizeof (void *);
+  do_iret (&if_);
+  NOT_REACHED ();
+}
+
+/* Waits for thread TID of the running process to exit and
+   returns the status it passed to uthread_exit().  Returns -1 at
+   once if TID is not a thread made by uthread_spawn() in this
+   process, is the caller, or has already been joined. */
+int
+uthread_wait (tid_t tid) {
+  struct thread *cur = thread_current ();
+  struct uthread_group *g = cur->group;
+  struct uthread *u = NULL;
+  struct list_elem *e;
+  int status;
+
+  if (g == NULL)
+    return -1;
+
+  lock_acquire (&g->lock);
+  for (e = list_begin (&g->threads); e != list_end (&g->threads);
+       e = list_next (e)) {
+    struct uthread *v = list_entry (e, struct uthread, elem);
+    if (v->tid == tid && !v->joining && v != cur->uthread) {
+      u = v;
+      u->joining = true;
+      break;
+    }
+  }
+  lock_release (&g->lock);
+  if (u == NULL)
+    return -1;
+
+  sema_down (&u->done);
+  lock_acquire (&g->lock);
+  list_remove (&u->elem);
+  lock_release (&g->lock);
+  status = u->status;
+  free (u);
+  return status;
+}
+
+/* Returns true if the running thread's process is exiting, so
+   that the thread should stop instead of returning to user
+   mode. */
+bool
+uthread_exiting (void) {
+  struct uthread_group *g = thread_current ()->group;
+  return g != NULL && g->exiting;
+}
+
+/* Stops the running thread if its process is exiting: exits the
+   process, if this is its main thread, or just this thread.
+   Called on the way into and out of the kernel. */
+void
+uthread_check_exit (void) {
+  struct thread *cur = thread_current ();
+
+  if (!uthread_exiting ())
+    return;
+  if (cur->uthread != NULL) {
+    cur->exit_status = -1;
+    thread_exit ();
+  }
+  exit_handler (cur->group->exit_status);
+}
+
+/* Handles exit(STATUS) in a thread made by uthread_spawn(): has
+   the whole process exit with STATUS, unless it already is, and
+   wakes its threads sleeping in futex_wait() so that they stop
+   too.  The caller then exits this thread. */
+void
+uthread_exit_process (int status) {
+  struct uthread_group *g = thread_current ()->group;
+
+  lock_acquire (&g->lock);
+  if (!g->exiting) {
+    g->exiting = true;
+    g->exit_status = status;
+  }
+  lock_release (&g->lock);
+  futex_wake_group (g);
+}
+
+/* Called by exec() before replacing the running process's
+   program.  Returns false if the process has other threads,
+   which exec() refuses to abandon, or if the caller is not its
+   main thread.  Otherwise frees the process's thread group, if
+   any, and returns true. */
+bool
+uthread_exec_prepare (void) {
+  struct thread *cur = thread_current ();
+  struct uthread_group *g = cur->group;
+
+  if (cur->uthread != NULL)
+    return false;
+  if (g == NULL)
+    return true;
+  lock_acquire (&g->lock);
+  if (g->live > 0) {
+    lock_release (&g->lock);
+    return false;
+  }
+  lock_release (&g->lock);
+  uthread_group_exit (cur);
+  return true;
+}
+
+/* Called by process_exit() for T, the running thread, which
+   uthread_spawn() made.  Frees its stack and lets a joiner reap
+   it, leaving the address space and files, which T shares, to
+   the process's main thread. */
+void
+uthread_release (struct thread *t) {
+  struct uthread *u = t->uthread;
+  struct uthread_group *g = u->group;
+  bool last;
+
+  ASSERT (t == thread_current ());
+
+  /* Stop using the page table before the main thread may free
+     it. */
+  t->pml4 = NULL;
+  pml4_activate (NULL);
+  t->image = NULL;
+#ifdef VM
+  t->spt = NULL;
+#endif
+  t->fd_table = NULL;
+  t->uthread = NULL;
+  t->group = NULL;
+
+  /* Once `done' is up, a joiner may free U, and once `drained'
+     is up, the main thread may free G. */
+  u->status = t->exit_status;
+  lock_acquire (&g->lock);
+  unmap_stack (g, u->slot);
+  g->stack_slots &= ~(1u << u->slot);
+  sema_up (&u->done);
+  last = --g->live == 0 && g->exiting;
+  lock_release (&g->lock);
+  if (last)
+    sema_up (&g->drained);
+}
+
+/* Called by process_exit() and exec() for T, the running
+   thread, which must be a process's main thread.  Stops the
+   process's other threads, waits for them to exit, and frees its
+   thread group.  Does nothing if T never created a thread.
+
+   Only futex_wait() can be interrupted.  A thread blocked in the
+   kernel anywhere else, say in read() from the keyboard or in
+   wait() for a child, stops only once that call returns.  Until
+   then T waits on `drained', and if the call never returns,
+   neither does T: the process cannot exit.  Such a process is
+   stuck until the keyboard delivers a key or the child exits. */
+void
+uthread_group_exit (struct thread *t) {
+  struct uthread_group *g = t->group;
+  bool wait;
+
+  ASSERT (t == thread_current ());
+  ASSERT (t->uthread == NULL);
+  if (g == NULL)
+    return;
+
+  lock_acquire (&g->lock);
+  if (!g->exiting) {
+    g->exiting = true;
+    g->exit_status = t->exit_status;
+  }
+  wait = g->live > 0;
+  lock_release (&g->lock);
+
+  if (wait) {
+    futex_wake_group (g);
+    sema_down (&g->drained);
+  }
+
+  /* Nobody joins the threads now. */
+  while (!list_empty (&g->threads))
+    free (list_entry (list_pop_front (&g->threads), struct uthread, elem));
+  t->group = NULL;
+  free (g);
+}
+
+#ifdef VM
+/* Gives G's process zeroed anonymous pages for stack slot SLOT,
+   claimed at once.  They are pages of its supplemental page table
+   like any other, so that they can be evicted, fork() copies them,
+   and system calls accept buffers in them.  Returns true if
+   successful, false if memory is exhausted. */
+static bool
+map_stack (struct uthread_group *g, int slot) {
+  uint8_t *top = (uint8_t *) stack_top (slot);
+  bool acquired = spt_acquire (g->spt);
+  bool success = true;
+  int i;
+
+  for (i = 1; i <= UTHREAD_STACK_PAGES && success; i++)
+    success = vm_alloc_page (VM_ANON, top - i * PGSIZE, true)
+              && vm_claim_page (top - i * PGSIZE);
+  if (!success)
+    unmap_stack (g, slot);
+  spt_release (g->spt, acquired);
+  return success;
+}
+
+/* Removes the pages of stack slot SLOT from G's process.  Unlike
+   at exit, the page table lives on, so the frames are unmapped
+   and freed (or their shares dropped) here. */
+static void
+unmap_stack (struct uthread_group *g, int slot) {
+  uint8_t *top = (uint8_t *) stack_top (slot);
+  bool acquired = spt_acquire (g->spt);
+  int i;
+
+  for (i = 1; i <= UTHREAD_STACK_PAGES; i++) {
+    void *upage = top - i * PGSIZE;
+    struct page *page = spt_find_page (g->spt, upage);
+    void *kpage;
+
+    if (page == NULL)
+      continue;
+    spt_remove_page (g->spt, page);
+    kpage = pml4_get_page (g->pml4, upage);
+    if (kpage != NULL) {
+      pml4_clear_page (g->pml4, upage);
+      palloc_free_page (kpage);
+    }
+  }
+  spt_release (g->spt, acquired);
+}
+#else
+/* Maps zeroed pages for stack slot SLOT into G's page table.
+   Returns true if successful, false if memory is exhausted. */
+static bool
+map_stack (struct uthread_group *g, int slot) {
+  uint64_t *pml4 = g->pml4;
+  uint8_t *top = (uint8_t *) stack_top (slot);
+  int i;
+
+  for (i = 1; i <= UTHREAD_STACK_PAGES; i++) {
+    void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+    if (kpage == NULL || !pml4_set_page (pml4, top - i * PGSIZE, kpage, true)) {
+      palloc_free_page (kpage);
+      while (--i >= 1) {
+        void *upage = top - i * PGSIZE;
+        palloc_free_page (pml4_get_page (pml4, upage));
+        pml4_clear_page (pml4, upage);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Unmaps and frees the pages of stack slot SLOT in G's page
+   table. */
+static void
+unmap_stack (struct uthread_group *g, int slot) {
+  uint64_t *pml4 = g->pml4;
+  uint8_t *top = (uint8_t *) stack_top (slot);
+  int i;
+
+  for (i = 1; i <= UTHREAD_STACK_PAGES; i++) {
+    void *upage = top - i * PGSIZE;
+    palloc_free_page (pml4_get_page (pml4, upage));
+    pml4_clear_page (pml4, upage);
+  }
+}
+#endif
@@ -1,7 +1,16 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <bitmap.h>
+#include <stdio.h>
+#include <string.h>
 #include "devices/disk.h"
+#include "devices/timer.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,11 +26,45 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* The swap disk is divided into page-sized slots: slot I is
+   sectors I * SECTORS_PER_SLOT through (I + 1) * SECTORS_PER_SLOT
+   - 1, so that a page always moves as one contiguous run. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Bit I is set while slot I holds a page.  NULL without a swap
+   disk. */
+static struct bitmap *swap_slots;
+static struct lock swap_lock;           /* Protects swap_slots. */
+
+/* Staging buffer for anon_swap_out_cluster(), which copies a
+   whole cluster here to write it with a single disk command. */
+static uint8_t *cluster_buf;
+static struct lock cluster_lock;        /* Protects cluster_buf. */
+
+/* Swap statistics, protected by swap_lock.  The TSC and tick
+   readings taken at start-up turn cycles into seconds. */
+static long long pages_out, pages_in, clusters_out;
+static uint64_t out_cycles, in_cycles;
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: swap_disk를 set_up */
-	swap_disk = NULL;
+	lock_init (&swap_lock);
+	lock_init (&cluster_lock);
+	start_tsc = rdtsc ();
+	start_ticks = timer_ticks ();
+
+	/* Without hd1:1, anonymous pages cannot be evicted. */
+	swap_disk = disk_get (1, 1);
+	if (swap_disk == NULL)
+		return;
+	swap_slots = bitmap_create (disk_size (swap_disk) / SECTORS_PER_SLOT);
+	cluster_buf = palloc_get_multiple (0, SWAP_CLUSTER);
+	if (swap_slots == NULL || cluster_buf == NULL)
+		PANIC ("swap: out of memory for %"PRDSNu"-sector swap disk",
+				disk_size (swap_disk));
 }
 
 /* Initialize the file mapping */
@@ -36,8 +79,11 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
-	anon_page->swap_index = -1;
-	
+	anon_page->swap_index = BITMAP_ERROR;
+
+	/* A new anonymous page reads as zeros, until a lazy loader, if
+	 * any, fills it in. */
+	memset (kva, 0, PGSIZE);
 	return true;
 }
 
@@ -45,16 +91,142 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot = anon_page->swap_index;
+	uint64_t start;
+
+	if (slot == BITMAP_ERROR)
+		return false;
+
+	start = rdtsc ();
+	disk_read_multiple (swap_disk, slot * SECTORS_PER_SLOT, SECTORS_PER_SLOT,
+			kva);
+	anon_page->swap_index = BITMAP_ERROR;
+
+	lock_acquire (&swap_lock);
+	bitmap_reset (swap_slots, slot);
+	pages_in++;
+	in_cycles += rdtsc () - start;
+	lock_release (&swap_lock);
+	return true;
+}
+
+/* Reads swapped-out anonymous PAGE into KVA, leaving it swapped
+   out.  fork() copies a page this way when it has no frame to
+   share. */
+void
+anon_read_swapped (struct page *page, void *kva) {
+	size_t slot = page->anon.swap_index;
+
+	ASSERT (slot != BITMAP_ERROR);
+	disk_read_multiple (swap_disk, slot * SECTORS_PER_SLOT, SECTORS_PER_SLOT,
+			kva);
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	return anon_swap_out_cluster (&page, 1) == 1;
+}
+
+/* Swaps out the first N of the CNT resident anonymous pages in
+   PAGES into N adjacent swap slots, with a single disk write, and
+   returns N.  N is CNT if CNT adjacent slots are free, otherwise
+   the longest run found by halving CNT, or 0 if swap is full.
+   Unmaps each page swapped out and detaches it from its frame,
+   which the caller may then reuse or free.  CNT must be between
+   1 and SWAP_CLUSTER. */
+size_t
+anon_swap_out_cluster (struct page *pages[], size_t cnt) {
+	size_t first = BITMAP_ERROR;
+	uint64_t start;
+	size_t i;
+
+	ASSERT (cnt >= 1 && cnt <= SWAP_CLUSTER);
+
+	if (swap_slots == NULL)
+		return 0;
+
+	lock_acquire (&swap_lock);
+	for (; cnt > 0; cnt /= 2) {
+		first = bitmap_scan_and_flip (swap_slots, 0, cnt, false);
+		if (first != BITMAP_ERROR)
+			break;
+	}
+	lock_release (&swap_lock);
+	if (cnt == 0)
+		return 0;
+
+	/* Unmap each page before copying it, so that its process
+	   cannot change it behind our back.  A fault on it from now
+	   on reads it back from its slot. */
+	start = rdtsc ();
+	lock_acquire (&cluster_lock);
+	for (i = 0; i < cnt; i++) {
+		struct page *page = pages[i];
+
+		ASSERT (page->frame != NULL);
+		pml4_clear_page (page->pml4, page->va);
+		memcpy (cluster_buf + i * PGSIZE, page->frame->kva, PGSIZE);
+		page->anon.swap_index = first + i;
+		page->frame = NULL;
+	}
+	disk_write_multiple (swap_disk, first * SECTORS_PER_SLOT,
+			cnt * SECTORS_PER_SLOT, cluster_buf);
+	lock_release (&cluster_lock);
+
+	lock_acquire (&swap_lock);
+	pages_out += cnt;
+	clusters_out++;
+	out_cycles += rdtsc () - start;
+	lock_release (&swap_lock);
+	return cnt;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->swap_index != BITMAP_ERROR) {
+		lock_acquire (&swap_lock);
+		bitmap_reset (swap_slots, anon_page->swap_index);
+		lock_release (&swap_lock);
+		anon_page->swap_index = BITMAP_ERROR;
+	}
+}
+
+/* Returns the rate at which PAGES pages moved in CYCLES TSC
+   cycles, at CYCLES_PER_SEC cycles per second, in hundredths of
+   a MB/s. */
+static long long
+swap_rate (long long pages, uint64_t cycles, uint64_t cycles_per_sec) {
+	uint64_t us = cycles / (cycles_per_sec / 1000000 + 1);
+
+	if (us == 0)
+		return 0;
+	return pages * PGSIZE * 100000000LL / (us * 1024 * 1024);
+}
+
+/* Prints swap statistics, including the throughput of swap-out
+   and swap-in, counting only the time spent in them. */
+void
+swap_print_stats (void) {
+	int64_t ticks = timer_elapsed (start_ticks);
+	uint64_t cycles_per_sec;
+	long long out_rate, in_rate;
+
+	if (swap_slots == NULL || ticks == 0)
+		return;
+	cycles_per_sec = (rdtsc () - start_tsc) / ticks * TIMER_FREQ;
+
+	lock_acquire (&swap_lock);
+	out_rate = swap_rate (pages_out, out_cycles, cycles_per_sec);
+	in_rate = swap_rate (pages_in, in_cycles, cycles_per_sec);
+	printf ("Swap: %lld pages out in %lld clusters, %lld pages in, "
+			"%zu of %zu slots in use\n", pages_out, clusters_out, pages_in,
+			bitmap_count (swap_slots, 0, bitmap_size (swap_slots), true),
+			bitmap_size (swap_slots));
+	printf ("Swap: out %lld.%02lld MB/s, in %lld.%02lld MB/s\n",
+			out_rate / 100, out_rate % 100, in_rate / 100, in_rate % 100);
+	lock_release (&swap_lock);
 }
@@ -1,6 +1,9 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -20,40 +23,71 @@ vm_file_init (void) {
 	//TODO : file_init 구현
 }
 
-/* Initialize the file backed page */
+/* Initialize the file backed page.  Where its data lies is known
+ * only to file_lazy_load(), which runs next. */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &file_ops;
+	return true;
+}
 
-	struct file_page *file_page = &page->file;
+/* Reads the data FP describes into the page at KVA and zeros the
+ * rest of the page.  Returns true if successful, false if the file
+ * is shorter than expected. */
+bool
+file_page_read (const struct file_page *fp, void *kva) {
+	if (file_read_at (fp->file, kva, fp->read_bytes, fp->ofs)
+			!= (off_t) fp->read_bytes)
+		return false;
+	memset ((uint8_t *) kva + fp->read_bytes, 0, PGSIZE - fp->read_bytes);
+	return true;
+}
+
+/* Loads a file-backed page on its first fault, from AUX, the
+ * malloc'd struct file_page it was allocated with.  A text page's
+ * frame holds its data already. */
+bool
+file_lazy_load (struct page *page, void *aux) {
+	page->file = *(struct file_page *) aux;
+	free (aux);
+	return page->file.text || file_page_read (&page->file, page->frame->kva);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	return file_page->text || file_page_read (file_page, kva);
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ * Only text pages are backed by a file, and are never written, so
+ * there is nothing to write back. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	pml4_clear_page (page->pml4, page->va);
+	page->frame = NULL;
+	return true;
 }
 
-/* Destory the file backed page. PAGE will be freed by the caller. */
+/* Destory the file backed page. PAGE will be freed by the caller.
+ * Like an anonymous page's frame, a text page's frame is unmapped,
+ * and its share of the frame dropped, with the page table. */
 static void
-file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+file_backed_destroy (struct page *page UNUSED) {
 }
 
 /* Do the mmap */
 void *
-do_mmap (void *addr, size_t length, int writable,
-		struct file *file, off_t offset) {
+do_mmap (void *addr UNUSED, size_t length UNUSED, int writable UNUSED,
+		struct file *file UNUSED, off_t offset UNUSED) {
+	return NULL;
 }
 
 /* Do the munmap */
 void
-do_munmap (void *addr) {
+do_munmap (void *addr UNUSED) {
 }
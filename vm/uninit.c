@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/malloc.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -63,7 +64,11 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE will be freed by the caller. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
-	/* TODO: Fill this function.
-	 * TODO: 아무것도 하지 않으면 Return된다. */
+	struct uninit_page *uninit = &page->uninit;
+
+	/* An aux is a malloc'd struct file_page, whose file belongs to
+	 * someone else, or null.  (The pages fork() fills from the
+	 * parent's are claimed as soon as they are made, and never
+	 * destroyed uninit.) */
+	free (uninit->aux);
 }